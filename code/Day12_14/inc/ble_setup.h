@@ -3,6 +3,19 @@
 
 #include <stdbool.h>
 
+/**
+ * @brief 广播阶段，从快到慢 (间隔和持续时间见 ble_setup.c 中的 adv_stages)
+ */
+enum ble_adv_stage {
+    BLE_ADV_STAGE_DIR_HIGH,     // 高占空比定向广播 (只发给绑定的手机)
+    BLE_ADV_STAGE_DIR_LOW,      // 低占空比定向广播
+    BLE_ADV_STAGE_FAST,
+    BLE_ADV_STAGE_MEDIUM,
+    BLE_ADV_STAGE_SLOW,
+    BLE_ADV_STAGE_DEEP_IDLE,
+    BLE_ADV_STAGE_COUNT,
+};
+
 /**
  * @brief 初始化蓝牙协议栈，配置回调，并启动初始广播
  * @return 0 表示成功，负数表示错误码
@@ -13,10 +26,17 @@ int ble_setup_init(void);
  * @brief 强制启动快速广播 (Fast Advertising)
  * 
  * 用于按键唤醒场景。如果当前已连接，此函数无效。
- * 快速广播持续一段时间后会自动切换回慢速广播。
+ * 快速广播持续一段时间后会逐级切换到更慢的广播阶段。
  */
 void ble_setup_start_fast_adv(void);
 
+/**
+ * @brief 把广播调度器重置到指定阶段
+ *
+ * 从该阶段开始按阶段表逐级变慢。已连接时无效。
+ */
+void ble_setup_adv_restart(enum ble_adv_stage stage);
+
 /**
  * @brief 获取当前蓝牙连接状态
  */
@@ -0,0 +1,46 @@
+#ifndef LAT_WAKE_H
+#define LAT_WAKE_H
+
+#include <zephyr/bluetooth/conn.h>
+
+/*
+ * 从机延迟 "有数据就醒" 模式
+ *
+ * 空闲时连接带较大的从机延迟 (Peripheral Latency)，从机每 (1 + latency) 个连接事件才醒一次。
+ * 应用有数据要发 (或状态变化需要通知) 时调用 lat_wake_hold()：立即让控制器停止跳过连接事件，
+ * 对端发来的数据也不用再等 latency × interval；数据发完调用 lat_wake_release()，
+ * 再等 LAT_WAKE_LINGER_MS (留给对端的应答) 后恢复跳过。
+ *
+ * 依赖 SoftDevice Controller 的厂商命令 (Peripheral Latency Mode Set)；其他控制器上只做统计。
+ *
+ * 统计 (断开时打印，也可以调用 lat_wake_report)：
+ *   wakes / wait     唤醒次数、每次从 hold 到 release 的时间 (数据排队时间)
+ *   awake            关闭从机延迟的时间占比
+ *   current          按连接事件数估算的平均电流，并和 "一直不跳过" 对比
+ */
+
+/**
+ * @brief 初始化每个连接的工作项 (在 bt_enable 之前调用一次)
+ */
+void lat_wake_init(void);
+
+/**
+ * @brief 有数据待发送：停止跳过连接事件
+ * @param conn 连接，NULL 表示所有连接
+ *
+ * 可在任意线程 (包括蓝牙回调) 中调用，和 lat_wake_release() 成对使用，可以嵌套。
+ */
+void lat_wake_hold(struct bt_conn *conn);
+
+/**
+ * @brief 数据已发完：稍后恢复从机延迟
+ * @param conn 连接，NULL 表示所有连接
+ */
+void lat_wake_release(struct bt_conn *conn);
+
+/**
+ * @brief 打印该连接的统计
+ */
+void lat_wake_report(struct bt_conn *conn);
+
+#endif // LAT_WAKE_H
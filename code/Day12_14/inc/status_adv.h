@@ -0,0 +1,45 @@
+#ifndef STATUS_ADV_H
+#define STATUS_ADV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * 无连接状态广播 (扩展广播 + 周期广播)
+ *
+ * 手机只想看一眼锁状态和电量时不必连接、配对、读取：独立的不可连接扩展广播集
+ * (主信道 1M，辅助信道 2M；STATUS_ADV_CODED 打开时两者都用 Coded PHY) 和挂在它上面的
+ * 周期广播都携带同一条状态记录。扫描端同步到周期广播后，无需持续扫描就能跟踪状态。
+ *
+ * 状态记录 (厂商数据，小端)：
+ *   [0..1]  公司 ID 0xFFFF (测试用)
+ *   [2]     记录版本 STATUS_ADV_VERSION
+ *   [3]     标志 bit0 = 开锁
+ *   [4]     电量 0-100，0xFF = 尚未采样
+ *   [5..6]  计数，记录每变化一次加 1 (扫描端据此判断是否有新状态)
+ *
+ * 记录原地更新 (不停止广播)，内容不变时不发 HCI 命令。与 ble_setup.c 的可连接广播并行运行，
+ * 连接期间也不停止。
+ */
+
+/**
+ * @brief 创建并启动状态广播 (在 bt_enable 之后调用)
+ * @return 0 表示成功，负数表示错误码
+ */
+int status_adv_init(void);
+
+/**
+ * @brief 更新记录中的锁状态
+ * @param is_unlocked true=开锁状态, false=关锁状态
+ *
+ * 可在任意线程中调用，实际更新在 System WorkQueue 中进行。
+ */
+void status_adv_set_lock(bool is_unlocked);
+
+/**
+ * @brief 更新记录中的电量
+ * @param level 电量百分比 0-100
+ */
+void status_adv_set_battery(uint8_t level);
+
+#endif // STATUS_ADV_H
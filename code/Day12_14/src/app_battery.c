@@ -4,6 +4,7 @@
 #include <zephyr/bluetooth/services/bas.h> // 标准电池服务接口
 
 #include "app_battery.h"
+#include "status_adv.h"
 
 LOG_MODULE_REGISTER(app_battery, LOG_LEVEL_INF);
 
@@ -77,6 +78,9 @@ static void battery_sample_handler(struct k_work *work)
     bt_bas_set_battery_level(battery_level);
     LOG_INF("Reported Battery Level: %d%%", battery_level);
 
+    // 同时写入无连接状态广播 (扩展广播 + 周期广播)
+    status_adv_set_battery(battery_level);
+
 reschedule:
     // 5. 重新调度下一次采样
     k_work_reschedule(&battery_work, K_MSEC(BATTERY_MEASURE_INTERVAL_MS));
@@ -12,25 +12,117 @@
 LOG_MODULE_REGISTER(ble_setup, LOG_LEVEL_INF);
 
 /* ----------------配置参数---------------- */
-#define FAST_ADV_DURATION_SEC   30 // 快速广播持续30秒
-
-// 快速广播参数: Interval 40ms - 50ms
-static const struct bt_le_adv_param *adv_param_fast =
-    BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE,
-                    BT_GAP_ADV_FAST_INT_MIN_2,
-                    BT_GAP_ADV_FAST_INT_MAX_2,
-                    NULL);
-
-// 慢速广播参数: Interval 1000ms - 1500ms
-static const struct bt_le_adv_param *adv_param_slow =
-    BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE,
-                    1600, // 1600 * 0.625us = 1000ms
-                    2400, // 2400 * 0.625us = 1500ms
-                    NULL);
+// 非定向广播：可连接，并在收到扫描请求时通知 (用于识别已绑定的手机)
+#define ADV_OPT_UNDIRECTED  (BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_NOTIFY_SCAN_REQ)
+// 定向广播：只有绑定的手机能连接。高占空比每 3.75ms 以内发一次，协议限定最长 1.28s
+#define ADV_OPT_DIR_HIGH    BT_LE_ADV_OPT_CONNECTABLE
+#define ADV_OPT_DIR_LOW     (BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_DIR_MODE_LOW_DUTY)
+
+/*
+ * 仅绑定模式：有绑定时，非定向广播只响应过滤接受列表 (绑定对象的身份地址) 中的扫描/连接请求。
+ * 控制器用解析列表把手机轮换的 RPA 解析成身份地址再比对，陌生手机的请求在链路层就被丢弃，不唤醒主机。
+ * 按键打开配对窗口 (按键触发的 fast 阶段不过滤)，让新手机可以连接配对。
+ */
+#define ADV_BONDED_ONLY     1
+#define ADV_OPT_FILTER      (BT_LE_ADV_OPT_FILTER_SCAN_REQ | BT_LE_ADV_OPT_FILTER_CONN)
+
+/*
+ * 广播阶段表：间隔范围 (单位 0.625ms) 和持续时间，到时自动进入下一阶段 (越来越慢)，
+ * 持续时间为 0 的阶段一直持续到连接。定向阶段发给存储的绑定对象，没有绑定时跳过。
+ * 触发条件 (adv_triggers) 把调度器重置到对应阶段，也可以用 ble_setup_adv_restart() 指定任意阶段。
+ */
+struct adv_stage {
+    const char *name;
+    uint32_t options;
+    uint16_t int_min;
+    uint16_t int_max;
+    uint32_t duration_ms;
+    bool directed;
+};
+
+static const struct adv_stage adv_stages[BLE_ADV_STAGE_COUNT] = {
+    // 高占空比定向广播的间隔由控制器决定，这里的 3.75ms 只用于估算
+    [BLE_ADV_STAGE_DIR_HIGH]  = { "dir-high",  ADV_OPT_DIR_HIGH,   6,    6,    1280,   true },
+    [BLE_ADV_STAGE_DIR_LOW]   = { "dir-low",   ADV_OPT_DIR_LOW,    48,   80,   5000,   true },  // 30-50ms, 5s
+    [BLE_ADV_STAGE_FAST]      = { "fast",      ADV_OPT_UNDIRECTED, BT_GAP_ADV_FAST_INT_MIN_2,
+                                               BT_GAP_ADV_FAST_INT_MAX_2,  30000,  false }, // 100-150ms, 30s
+    [BLE_ADV_STAGE_MEDIUM]    = { "medium",    ADV_OPT_UNDIRECTED, 800,  960,  60000,  false }, // 500-600ms, 1min
+    [BLE_ADV_STAGE_SLOW]      = { "slow",      ADV_OPT_UNDIRECTED, 1600, 2400, 600000, false }, // 1-1.5s, 10min
+    [BLE_ADV_STAGE_DEEP_IDLE] = { "deep-idle", ADV_OPT_UNDIRECTED, 8000, 9600, 0,      false }, // 5-6s, 不限时
+};
+
+// 触发条件 → 目标阶段。当前阶段已经比目标更快时忽略 (不会因为触发反而变慢)，
+// 定向阶段除外：只有绑定的手机能连，按键等触发要求立即对所有手机可见
+enum adv_trigger {
+    ADV_TRIGGER_BOOT,
+    ADV_TRIGGER_BUTTON,
+    ADV_TRIGGER_DISCONNECT,     // 先定向广播给绑定的手机，让它最快重连
+    ADV_TRIGGER_BONDED_SEEN,    // 已绑定的手机发来扫描请求，说明它就在附近
+};
+
+static const struct {
+    const char *name;
+    enum ble_adv_stage stage;
+} adv_triggers[] = {
+    [ADV_TRIGGER_BOOT]        = { "boot",        BLE_ADV_STAGE_SLOW },
+    [ADV_TRIGGER_BUTTON]      = { "button",      BLE_ADV_STAGE_FAST },
+    [ADV_TRIGGER_DISCONNECT]  = { "disconnect",  BLE_ADV_STAGE_DIR_HIGH },
+    [ADV_TRIGGER_BONDED_SEEN] = { "bonded peer", BLE_ADV_STAGE_FAST },
+};
+
+/*
+ * 估算常数 (nRF52832 @ 3 V，需用功耗分析仪校准)
+ * 一个可连接广播事件 (3 个信道，31 字节) 约 11 uC；nC/ms 正好是 uA
+ */
+#define ADV_EVENT_NC        11000
+#define ADV_DELAY_AVG_MS    5       // 协议规定每个广播事件随机推迟 0-10ms
 
 /* ----------------全局变量---------------- */
 static struct bt_conn *current_conn = NULL; // 当前连接句柄
-static struct k_work_delayable adv_mode_work; // 用于广播超时切换的定时任务
+static struct k_work_delayable adv_mode_work; // 用于广播阶段超时切换的定时任务
+static struct k_work adv_bonded_work;         // 看到已绑定手机后在 WorkQueue 中触发
+static struct k_work adv_restart_work;        // 断开后连接对象回收时在 WorkQueue 中重新广播
+
+/*
+ * 常驻广播集：初始化时创建一次，之后切换阶段只改参数，广播数据留在控制器里不再下发。
+ * 以前的 bt_le_adv_stop() + bt_le_adv_start() 每次都会删除并重建广播集、重新下发参数和数据。
+ */
+static struct bt_le_ext_adv *adv_set;
+static enum ble_adv_stage adv_cur_stage;    // 广播集当前使用的阶段参数
+static bool adv_enabled;                    // 广播集是否在运行 (连接建立后控制器自动停止)
+static int64_t adv_stage_since_ms;          // 进入当前阶段的时间
+static bt_addr_le_t adv_bond_peer;          // 定向广播的目标 (存储的绑定对象)
+static atomic_t adv_restart_pending;        // 断开后等连接对象回收再启动广播
+static bool adv_cur_filter;                 // 广播集当前是否只接受绑定对象
+static bool adv_data_loaded;                // 广播集中是否有广播数据 (定向广播不能带数据)
+static bool adv_pairing_open;               // 按键打开的配对窗口 (不过滤)
+static bool adv_accept_list_dirty = true;   // 绑定变化后，下次广播停止时重建过滤接受列表
+
+// 主机被扫描请求/陌生连接唤醒的次数 (仅绑定模式下应该只剩绑定手机的)
+static uint32_t adv_scan_reqs;
+static uint32_t adv_scan_reqs_bonded;
+static uint32_t stranger_conns;
+
+// 重连统计：从断开到重新加密
+static int64_t reconnect_start_ms;
+static uint32_t reconnect_conn_ms;
+static uint32_t reconnects;
+static uint64_t reconnect_sum_ms;
+static uint32_t reconnect_max_ms;
+
+// 切换统计 (只统计广播运行中的切换)
+static uint32_t adv_switches;
+static uint32_t adv_gap_max_us;
+static uint64_t adv_gap_sum_us;
+
+// 每阶段统计
+static struct {
+    uint32_t entries;
+    uint32_t connects;
+    uint64_t ttc_sum_ms;    // 从进入该阶段到连接的时间
+    uint32_t ttc_max_ms;
+    uint64_t time_ms;       // 在该阶段广播的累计时间
+} adv_stats[BLE_ADV_STAGE_COUNT];
 
 /* 
  * 广播数据包 (Advertising Data)
@@ -44,52 +136,294 @@ static const struct bt_data ad[] = {
 };
 
 /* ----------------内部函数声明---------------- */
-static void start_advertising_slow(void);
-static void start_advertising_fast(void);
+static void adv_stage_enter(enum ble_adv_stage stage);
+static void adv_trigger(enum adv_trigger trigger);
 static void security_changed(struct bt_conn *conn, bt_security_t level,
                              enum bt_security_err err);
 /* ----------------WorkQueue 回调---------------- */
-// 当快速广播 30秒超时后执行此函数
+// 当前阶段超时后执行此函数，进入下一 (更慢的) 阶段
 static void adv_timeout_handler(struct k_work *work)
 {
-    LOG_INF("Fast advertising timeout. Switching to SLOW advertising.");
-    
-    // 停止当前广播
-    bt_le_adv_stop();
-    
-    // 切换到慢速广播 (永久运行，直到连接或掉电)
-    start_advertising_slow();
+    if (adv_cur_stage + 1 < BLE_ADV_STAGE_COUNT) {
+        adv_stage_enter(adv_cur_stage + 1);
+    }
+}
+
+static void adv_bonded_work_handler(struct k_work *work)
+{
+    adv_trigger(ADV_TRIGGER_BONDED_SEEN);
+}
+
+static void adv_restart_work_handler(struct k_work *work)
+{
+    if (atomic_cas(&adv_restart_pending, 1, 0)) {
+        adv_trigger(ADV_TRIGGER_DISCONNECT);
+    }
 }
 
 /* ----------------辅助函数---------------- */
-static void start_advertising_fast(void)
+// 平均广播间隔 (ms)，含随机推迟
+static uint32_t adv_stage_period_ms(enum ble_adv_stage stage)
 {
-    int err = bt_le_adv_start(adv_param_fast, ad, ARRAY_SIZE(ad), NULL, 0);
+    return (adv_stages[stage].int_min + adv_stages[stage].int_max) * 5 / 16 + ADV_DELAY_AVG_MS;
+}
+
+static void accept_list_add(const struct bt_bond_info *info, void *user_data)
+{
+    int *hci_cmds = user_data;
+    int err = bt_le_filter_accept_list_add(&info->addr);
+
+    (*hci_cmds)++;
     if (err) {
-        if (err == -EALREADY) return; // 已经在广播中，忽略
-        LOG_ERR("Failed to start fast advertising (err %d)", err);
-    } else {
-        LOG_INF("Fast advertising started (30s timeout)");
-        // 启动/重置 30秒 倒计时
-        k_work_reschedule(&adv_mode_work, K_SECONDS(FAST_ADV_DURATION_SEC));
+        LOG_ERR("Failed to add bond to accept list (err %d)", err);
+    }
+}
+
+// 用存储的绑定重建过滤接受列表 (解析列表由协议栈在加载/新增绑定时自动写入控制器)。
+// 控制器不允许在广播使用列表时修改它，所以只在广播集停止时调用
+static int adv_accept_list_refresh(int *hci_cmds)
+{
+    int err = bt_le_filter_accept_list_clear();
+
+    (*hci_cmds)++;
+    if (err) {
+        return err;
     }
+    bt_foreach_bond(BT_ID_DEFAULT, accept_list_add, hci_cmds);
+    adv_accept_list_dirty = false;
+    return 0;
 }
 
-static void start_advertising_slow(void)
+/*
+ * 把常驻广播集切换到新阶段的参数并确保在广播
+ *
+ * 协议规定广播集运行中不能改参数，所以最少是 停止 → 改参数 → 启动 三条 HCI 命令，
+ * 数据保持不变。停止返回到启动返回之间射频不发广播，记为 gap。
+ * 阶段和过滤都没变且已经在广播时什么都不做。
+ * 传统定向广播 PDU 不能携带广播数据，控制器会拒绝有数据的广播集改成定向参数，
+ * 所以进入定向阶段前先清空数据，回到非定向阶段时再写回。
+ */
+static int adv_switch(enum ble_adv_stage stage, bool filter)
 {
-    int err = bt_le_adv_start(adv_param_slow, ad, ARRAY_SIZE(ad), NULL, 0);
+    const struct adv_stage *st = &adv_stages[stage];
+    struct bt_le_adv_param param =
+        BT_LE_ADV_PARAM_INIT(st->options | (filter ? ADV_OPT_FILTER : 0),
+                             st->int_min, st->int_max,
+                             st->directed ? &adv_bond_peer : NULL);
+    // 高占空比定向广播必须带超时 (单位 10ms)，其余阶段由 adv_mode_work 计时
+    struct bt_le_ext_adv_start_param start = {
+        .timeout = (st->directed && !(st->options & BT_LE_ADV_OPT_DIR_MODE_LOW_DUTY)) ?
+                   st->duration_ms / 10 : 0,
+    };
+    bool was_enabled = adv_enabled;
+    uint32_t stopped = 0;
+    uint32_t gap_us;
+    int hci_cmds = 0;
+    int err;
+
+    if (adv_enabled && stage == adv_cur_stage && filter == adv_cur_filter) {
+        return -EALREADY;
+    }
+
+    if (adv_enabled) {
+        err = bt_le_ext_adv_stop(adv_set);
+        hci_cmds++;
+        if (err) {
+            return err;
+        }
+        adv_enabled = false;
+        stopped = k_cycle_get_32();
+    }
+
+    if (filter && adv_accept_list_dirty) {
+        err = adv_accept_list_refresh(&hci_cmds);
+        if (err) {
+            return err;
+        }
+    }
+
+    if (st->directed && adv_data_loaded) {
+        err = bt_le_ext_adv_set_data(adv_set, NULL, 0, NULL, 0);
+        hci_cmds++;
+        if (err) {
+            return err;
+        }
+        adv_data_loaded = false;
+    }
+
+    if (stage != adv_cur_stage || filter != adv_cur_filter) {
+        err = bt_le_ext_adv_update_param(adv_set, &param);
+        hci_cmds++;
+        if (err) {
+            return err;
+        }
+        adv_cur_stage = stage;
+        adv_cur_filter = filter;
+    }
+
+    if (!st->directed && !adv_data_loaded) {
+        err = bt_le_ext_adv_set_data(adv_set, ad, ARRAY_SIZE(ad), NULL, 0);
+        hci_cmds++;
+        if (err) {
+            return err;
+        }
+        adv_data_loaded = true;
+    }
+
+    err = bt_le_ext_adv_start(adv_set, &start);
+    hci_cmds++;
     if (err) {
-        LOG_ERR("Failed to start slow advertising (err %d)", err);
+        return err;
+    }
+    adv_enabled = true;
+
+    if (was_enabled) {
+        gap_us = k_cyc_to_us_floor32(k_cycle_get_32() - stopped);
+        adv_switches++;
+        adv_gap_sum_us += gap_us;
+        adv_gap_max_us = MAX(adv_gap_max_us, gap_us);
+        LOG_INF("Adv switch #%u: %d HCI cmds, gap %u us (avg %u, max %u us)",
+                adv_switches, hci_cmds, gap_us,
+                (uint32_t)(adv_gap_sum_us / adv_switches), adv_gap_max_us);
+    }
+    return 0;
+}
+
+// 停止计时当前阶段 (切换阶段、连接建立时调用)
+static void adv_stage_account(int64_t now)
+{
+    if (adv_enabled) {
+        adv_stats[adv_cur_stage].time_ms += now - adv_stage_since_ms;
+    }
+}
+
+static void bond_first(const struct bt_bond_info *info, void *user_data)
+{
+    bool *found = user_data;
+
+    if (!*found) {
+        bt_addr_le_copy(&adv_bond_peer, &info->addr);
+        *found = true;
+    }
+}
+
+static void adv_stage_enter(enum ble_adv_stage stage)
+{
+    const struct adv_stage *st;
+    int64_t now = k_uptime_get();
+    bool bonded = false;
+    bool filter;
+    int err;
+
+    // 定向阶段需要绑定对象 (CONFIG_BT_MAX_PAIRED=1，取第一个)，没有就跳到后面的非定向阶段
+    bt_foreach_bond(BT_ID_DEFAULT, bond_first, &bonded);
+    while (adv_stages[stage].directed && !bonded) {
+        stage++;
+    }
+    st = &adv_stages[stage];
+
+    // 配对窗口只在按键触发的 fast 阶段内有效
+    if (stage != BLE_ADV_STAGE_FAST) {
+        adv_pairing_open = false;
+    }
+    filter = ADV_BONDED_ONLY && bonded && !st->directed && !adv_pairing_open;
+
+    adv_stage_account(now);
+    adv_stage_since_ms = now;
+
+    err = adv_switch(stage, filter);
+    if (err && err != -EALREADY) { // -EALREADY: 已经在该阶段，只重置计时
+        LOG_ERR("Failed to start %s advertising (err %d)", st->name, err);
+        // 不能停在这里 (否则再也不广播)，直接进入下一阶段
+        if (stage + 1 < BLE_ADV_STAGE_COUNT) {
+            adv_stage_enter(stage + 1);
+        }
+        return;
+    }
+
+    adv_stats[stage].entries++;
+    LOG_INF("Advertising stage: %s (%u-%u ms, %u ms%s)", st->name,
+            st->int_min * 5 / 8, st->int_max * 5 / 8, st->duration_ms,
+            filter ? ", bonded only" : "");
+
+    if (st->duration_ms) {
+        k_work_reschedule(&adv_mode_work, K_MSEC(st->duration_ms));
     } else {
-        LOG_INF("Slow advertising started (Infinite)");
+        // 最后一个阶段不需要超时处理，取消任何挂起的定时器
+        k_work_cancel_delayable(&adv_mode_work);
     }
-    // 慢速广播不需要超时处理，取消任何挂起的定时器
-    k_work_cancel_delayable(&adv_mode_work);
 }
 
+static void adv_trigger(enum adv_trigger trigger)
+{
+    enum ble_adv_stage stage = adv_triggers[trigger].stage;
+
+    if (current_conn ||
+        (adv_enabled && adv_cur_stage < stage && !adv_stages[adv_cur_stage].directed)) {
+        return;
+    }
+
+    LOG_INF("Adv trigger: %s", adv_triggers[trigger].name);
+    adv_stage_enter(stage);
+}
+
+/*
+ * 每阶段报告 (连接建立时打印)：
+ *   ttc       从进入该阶段到连接的时间，expected 按扫描端 100% 占空比估算 (平均半个广播周期)
+ *   time/uA   在该阶段广播的累计时间、按广播事件数估算的平均电流和累计电荷
+ */
+static void adv_report(void)
+{
+    for (int i = 0; i < BLE_ADV_STAGE_COUNT; i++) {
+        uint32_t period = adv_stage_period_ms(i);
+        uint32_t ua = ADV_EVENT_NC / period;
+
+        if (!adv_stats[i].entries) {
+            continue;
+        }
+        LOG_INF("%-9s: %u entries, %u conn, ttc avg %u max %u ms (expected %u ms), "
+                "%u s, ~%u uA, %u uC",
+                adv_stages[i].name, adv_stats[i].entries, adv_stats[i].connects,
+                adv_stats[i].connects ?
+                    (uint32_t)(adv_stats[i].ttc_sum_ms / adv_stats[i].connects) : 0,
+                adv_stats[i].ttc_max_ms, period / 2,
+                (uint32_t)(adv_stats[i].time_ms / 1000), ua,
+                (uint32_t)(adv_stats[i].time_ms * ua / 1000));
+    }
+    LOG_INF("scan req %u (bonded %u), stranger conns %u",
+            adv_scan_reqs, adv_scan_reqs_bonded, stranger_conns);
+}
+
+/* ----------------广播集回调---------------- */
+// 收到扫描请求 (BT RX 线程)：来自已绑定的手机且当前比 fast 慢时，切回 fast
+static void adv_scanned(struct bt_le_ext_adv *adv, struct bt_le_ext_adv_scanned_info *info)
+{
+    adv_scan_reqs++;
+    if (!bt_addr_le_is_bonded(BT_ID_DEFAULT, info->addr)) {
+        return;
+    }
+
+    adv_scan_reqs_bonded++;
+    if (adv_cur_stage > adv_triggers[ADV_TRIGGER_BONDED_SEEN].stage) {
+        k_work_submit(&adv_bonded_work);
+    }
+}
+
+static const struct bt_le_ext_adv_cb adv_cb = {
+    .scanned = adv_scanned,
+};
+
 /* ----------------连接回调 (Connection Callbacks)---------------- */
 static void connected(struct bt_conn *conn, uint8_t err)
 {
+    if (err == BT_HCI_ERR_ADV_TIMEOUT) {
+        // 高占空比定向广播到时没人连，adv_mode_work 会进入下一阶段
+        LOG_INF("High duty directed advertising timed out");
+        // 广播集已经停止，之后的时间不再记入该阶段
+        adv_stage_account(k_uptime_get());
+        adv_enabled = false;
+        return;
+    }
     if (err) {
         LOG_ERR("Connection failed (err 0x%02x)", err);
         return;
@@ -97,6 +431,27 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
     LOG_INF("Connected");
     current_conn = bt_conn_ref(conn);
+    adv_pairing_open = false;
+    if (!bt_addr_le_is_bonded(BT_ID_DEFAULT, bt_conn_get_dst(conn))) {
+        stranger_conns++;
+    }
+
+    // 记录本阶段的连接耗时，可连接广播在连接建立时被控制器停止
+    if (adv_enabled) {
+        int64_t now = k_uptime_get();
+        uint32_t ttc = (uint32_t)(now - adv_stage_since_ms);
+
+        adv_stage_account(now);
+        adv_stats[adv_cur_stage].connects++;
+        adv_stats[adv_cur_stage].ttc_sum_ms += ttc;
+        adv_stats[adv_cur_stage].ttc_max_ms = MAX(adv_stats[adv_cur_stage].ttc_max_ms, ttc);
+        LOG_INF("Connected in %s stage after %u ms", adv_stages[adv_cur_stage].name, ttc);
+        adv_enabled = false;
+        adv_report();
+    }
+    if (reconnect_start_ms) {
+        reconnect_conn_ms = (uint32_t)(k_uptime_get() - reconnect_start_ms);
+    }
 
     // 连接成功后，停止广播超时计时器
     k_work_cancel_delayable(&adv_mode_work);
@@ -113,14 +468,26 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
         current_conn = NULL;
     }
 
-    // 断开连接后，立即进入快速广播以便重连
-    start_advertising_fast();
+    // 断开连接后立即重新广播以便重连。定向广播要占用一个连接对象，
+    // 而此时旧的连接对象还没回收 (CONFIG_BT_MAX_CONN=1)，所以放到 recycled 回调里启动
+    reconnect_start_ms = k_uptime_get();
+    atomic_set(&adv_restart_pending, 1);
+}
+
+// 在最后一次 bt_conn_unref() 的线程里调用，要当作中断处理：不直接发 HCI 命令，
+// 交给 WorkQueue，所有广播切换都在系统工作队列上串行执行
+static void recycled(void)
+{
+    if (atomic_get(&adv_restart_pending)) {
+        k_work_submit(&adv_restart_work);
+    }
 }
 
 // 注册连接回调结构体
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = connected,
     .disconnected = disconnected,
+    .recycled = recycled,
     .security_changed = security_changed,
 };
 
@@ -133,6 +500,19 @@ static void security_changed(struct bt_conn *conn, bt_security_t level,
 
     if (!err) {
         LOG_INF("Security changed: %s level %u", addr, level);
+
+        // 断开后第一次重新加密：记录重连耗时
+        if (reconnect_start_ms && level >= BT_SECURITY_L2) {
+            uint32_t ms = (uint32_t)(k_uptime_get() - reconnect_start_ms);
+
+            reconnect_start_ms = 0;
+            reconnects++;
+            reconnect_sum_ms += ms;
+            reconnect_max_ms = MAX(reconnect_max_ms, ms);
+            LOG_INF("Reconnect #%u: connected %u ms, encrypted %u ms (avg %u, max %u ms)",
+                    reconnects, reconnect_conn_ms, ms,
+                    (uint32_t)(reconnect_sum_ms / reconnects), reconnect_max_ms);
+        }
     } else {
         LOG_ERR("Security failed: %s level %u err %d", addr, level, err);
     }
@@ -159,6 +539,11 @@ static struct bt_conn_auth_cb auth_cb_display = {
 static void auth_pairing_complete(struct bt_conn *conn, bool bonded)
 {
     LOG_INF("Pairing Complete. Bonded: %d", bonded);
+
+    // 新绑定：下次启动广播前把它加入过滤接受列表
+    if (bonded) {
+        adv_accept_list_dirty = true;
+    }
 }
 
 static struct bt_conn_auth_info_cb auth_cb_info = {
@@ -174,6 +559,8 @@ int ble_setup_init(void)
 
     // 1. 初始化定时器 (保持不变)
     k_work_init_delayable(&adv_mode_work, adv_timeout_handler);
+    k_work_init(&adv_bonded_work, adv_bonded_work_handler);
+    k_work_init(&adv_restart_work, adv_restart_work_handler);
 
     // 2. 注册回调 (保持不变)
     bt_conn_auth_cb_register(&auth_cb_display);
@@ -195,8 +582,26 @@ int ble_setup_init(void)
 
     LOG_INF("Bluetooth initialized");
 
-    // 4. 启动广播
-    start_advertising_slow(); 
+    // 4. 创建常驻广播集并写入广播数据 (之后只改参数，数据不再下发)
+    adv_cur_stage = adv_triggers[ADV_TRIGGER_BOOT].stage;
+    err = bt_le_ext_adv_create(BT_LE_ADV_PARAM(adv_stages[adv_cur_stage].options,
+                                               adv_stages[adv_cur_stage].int_min,
+                                               adv_stages[adv_cur_stage].int_max, NULL),
+                               &adv_cb, &adv_set);
+    if (err) {
+        LOG_ERR("Failed to create advertising set (err %d)", err);
+        return err;
+    }
+
+    err = bt_le_ext_adv_set_data(adv_set, ad, ARRAY_SIZE(ad), NULL, 0);
+    if (err) {
+        LOG_ERR("Failed to set advertising data (err %d)", err);
+        return err;
+    }
+    adv_data_loaded = true;
+
+    // 5. 启动广播
+    adv_trigger(ADV_TRIGGER_BOOT);
 
     return 0;
 }
@@ -209,11 +614,19 @@ void ble_setup_start_fast_adv(void)
         return;
     }
 
-    // 停止当前可能正在运行的慢速广播
-    bt_le_adv_stop();
-    
-    // 启动快速广播
-    start_advertising_fast();
+    // 直接切换到快速广播 (adv_switch 内部完成停止/改参数/启动)，
+    // 按键同时打开配对窗口，新手机可以连接
+    adv_pairing_open = true;
+    adv_trigger(ADV_TRIGGER_BUTTON);
+}
+
+void ble_setup_adv_restart(enum ble_adv_stage stage)
+{
+    if (current_conn || stage >= BLE_ADV_STAGE_COUNT) {
+        return;
+    }
+
+    adv_stage_enter(stage);
 }
 
 bool ble_is_connected(void)
@@ -0,0 +1,247 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/conn.h>
+
+#if defined(CONFIG_BT_LL_SOFTDEVICE)
+#include <sdc_hci_vs.h>
+#define LAT_WAKE_VS 1
+#else
+#define LAT_WAKE_VS 0
+#endif
+
+#include "lat_wake.h"
+
+LOG_MODULE_REGISTER(lat_wake, LOG_LEVEL_INF);
+
+/* ----------------配置参数---------------- */
+#define LAT_WAKE_LINGER_MS      200     // 数据发完后再保持清醒这么久，等对端的应答/下一条命令
+
+/*
+ * 电流估算常数 (nRF52832 @ 3 V，需用功耗分析仪校准)
+ * 一个连接事件约 2.5 uC；nC/ms 正好是 uA
+ */
+#define LAT_WAKE_EVENT_NC       2500
+#define LAT_WAKE_SLEEP_UA       3       // System ON 空闲电流
+
+/* ----------------每连接状态---------------- */
+struct lat_wake {
+    struct bt_conn *conn;
+    uint16_t handle;
+    atomic_t holds;             // 未配对的 hold 次数
+    bool awake;                 // 控制器当前是否已停止跳过连接事件
+    int64_t hold_ms;            // 本轮第一次 hold 的时间
+    int64_t awake_since_ms;
+    int64_t connected_ms;
+    // 统计
+    uint32_t wakes;
+    uint32_t cycles;            // hold → release 次数 (等待时间按它平均)
+    int64_t awake_total_ms;
+    uint64_t wait_sum_ms;
+    uint32_t wait_max_ms;
+    struct k_work_delayable work;
+};
+
+static struct lat_wake lat_wakes[CONFIG_BT_MAX_CONN];
+
+/* ----------------控制器命令---------------- */
+static int latency_mode_set(struct lat_wake *lw, bool skip)
+{
+#if LAT_WAKE_VS
+    sdc_hci_cmd_vs_peripheral_latency_mode_set_t *cp;
+    struct net_buf *buf;
+
+    buf = bt_hci_cmd_create(SDC_HCI_OPCODE_CMD_VS_PERIPHERAL_LATENCY_MODE_SET, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->conn_handle = sys_cpu_to_le16(lw->handle);
+    cp->mode = skip ? SDC_HCI_VS_PERIPHERAL_LATENCY_MODE_ENABLE
+                    : SDC_HCI_VS_PERIPHERAL_LATENCY_MODE_DISABLE;
+    return bt_hci_cmd_send_sync(SDC_HCI_OPCODE_CMD_VS_PERIPHERAL_LATENCY_MODE_SET, buf, NULL);
+#else
+    // 标准 HCI 没有对应命令，只能改连接参数 (要对端同意，太慢)，这里只做统计
+    return -ENOTSUP;
+#endif
+}
+
+// 在 System WorkQueue 中按 holds 切换控制器的从机延迟模式
+static void lat_wake_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct lat_wake *lw = CONTAINER_OF(dwork, struct lat_wake, work);
+    bool want_awake = atomic_get(&lw->holds) > 0;
+    int64_t now = k_uptime_get();
+    int err;
+
+    if (!lw->conn || want_awake == lw->awake) {
+        return;
+    }
+
+    err = latency_mode_set(lw, !want_awake);
+    if (err && err != -ENOTSUP) {
+        LOG_WRN("Peripheral latency mode set failed (err %d)", err);
+        return;
+    }
+
+    lw->awake = want_awake;
+    if (want_awake) {
+        lw->wakes++;
+        lw->awake_since_ms = now;
+    } else {
+        lw->awake_total_ms += now - lw->awake_since_ms;
+    }
+}
+
+static struct lat_wake *lat_wake_get(struct bt_conn *conn)
+{
+    struct lat_wake *lw = &lat_wakes[bt_conn_index(conn)];
+
+    return lw->conn == conn ? lw : NULL;
+}
+
+static void hold_one(struct lat_wake *lw)
+{
+    if (atomic_inc(&lw->holds) == 0) {
+        lw->hold_ms = k_uptime_get();
+        k_work_reschedule(&lw->work, K_NO_WAIT);
+    }
+}
+
+static void release_one(struct lat_wake *lw)
+{
+    uint32_t wait;
+
+    if (atomic_get(&lw->holds) <= 0 || atomic_dec(&lw->holds) != 1) {
+        return;
+    }
+
+    wait = (uint32_t)(k_uptime_get() - lw->hold_ms);
+    lw->cycles++;
+    lw->wait_sum_ms += wait;
+    lw->wait_max_ms = MAX(lw->wait_max_ms, wait);
+    k_work_reschedule(&lw->work, K_MSEC(LAT_WAKE_LINGER_MS));
+}
+
+/* ----------------连接回调---------------- */
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    struct lat_wake *lw = &lat_wakes[bt_conn_index(conn)];
+
+    if (err || bt_hci_get_conn_handle(conn, &lw->handle)) {
+        return;
+    }
+
+    atomic_clear(&lw->holds);
+    lw->awake = false;
+    lw->wakes = 0;
+    lw->cycles = 0;
+    lw->awake_total_ms = 0;
+    lw->wait_sum_ms = 0;
+    lw->wait_max_ms = 0;
+    lw->connected_ms = k_uptime_get();
+    lw->conn = bt_conn_ref(conn);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct lat_wake *lw = lat_wake_get(conn);
+    struct k_work_sync sync;
+
+    if (!lw) {
+        return;
+    }
+
+    /* 工作项可能正阻塞在旧连接的 HCI 命令里，等它结束再释放 */
+    k_work_cancel_delayable_sync(&lw->work, &sync);
+    lat_wake_report(conn);
+    bt_conn_unref(lw->conn);
+    lw->conn = NULL;
+}
+
+BT_CONN_CB_DEFINE(lat_wake_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+};
+
+/* ----------------对外接口---------------- */
+void lat_wake_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(lat_wakes); i++) {
+        k_work_init_delayable(&lat_wakes[i].work, lat_wake_work_handler);
+    }
+}
+
+void lat_wake_hold(struct bt_conn *conn)
+{
+    if (conn) {
+        struct lat_wake *lw = lat_wake_get(conn);
+
+        if (lw) {
+            hold_one(lw);
+        }
+        return;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(lat_wakes); i++) {
+        if (lat_wakes[i].conn) {
+            hold_one(&lat_wakes[i]);
+        }
+    }
+}
+
+void lat_wake_release(struct bt_conn *conn)
+{
+    if (conn) {
+        struct lat_wake *lw = lat_wake_get(conn);
+
+        if (lw) {
+            release_one(lw);
+        }
+        return;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(lat_wakes); i++) {
+        if (lat_wakes[i].conn) {
+            release_one(&lat_wakes[i]);
+        }
+    }
+}
+
+void lat_wake_report(struct bt_conn *conn)
+{
+    struct lat_wake *lw = lat_wake_get(conn);
+    struct bt_conn_info info;
+    int64_t total_ms;
+    int64_t awake_ms;
+    uint32_t interval_us;
+    uint64_t events;
+    uint64_t events_awake;
+
+    if (!lw || bt_conn_get_info(conn, &info)) {
+        return;
+    }
+
+    total_ms = k_uptime_get() - lw->connected_ms;
+    awake_ms = lw->awake_total_ms + (lw->awake ? k_uptime_get() - lw->awake_since_ms : 0);
+    interval_us = info.le.interval * 1250U;
+    if (total_ms <= 0 || !interval_us) {
+        return;
+    }
+
+    // 按当前连接参数估算：清醒时每个事件都参加，其余时间每 (1 + latency) 个参加一个
+    events = (uint64_t)awake_ms * 1000 / interval_us +
+             (uint64_t)(total_ms - awake_ms) * 1000 / (interval_us * (1U + info.le.latency));
+    events_awake = (uint64_t)total_ms * 1000 / interval_us;
+
+    LOG_INF("wakes %u, holds %u, wait avg %u max %u ms (worst without wake %u ms)",
+            lw->wakes, lw->cycles, lw->cycles ? (uint32_t)(lw->wait_sum_ms / lw->cycles) : 0,
+            lw->wait_max_ms, (1U + info.le.latency) * interval_us / 1000);
+    LOG_INF("awake %lld/%lld ms, est current %u uA (never skipping %u uA)",
+            awake_ms, total_ms,
+            (uint32_t)(LAT_WAKE_SLEEP_UA + events * LAT_WAKE_EVENT_NC / total_ms),
+            (uint32_t)(LAT_WAKE_SLEEP_UA + events_awake * LAT_WAKE_EVENT_NC / total_ms));
+}
@@ -2,6 +2,8 @@
 #include <zephyr/logging/log.h>
 #include "app_lock.h"
 #include "ble_setup.h"
+#include "status_adv.h"
+#include "lat_wake.h"
 // #include "app_battery.h" // 待实现
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 int main(void)
@@ -21,13 +23,20 @@ int main(void)
         LOG_ERR("Failed to init battery: %d", err);
         return 0;
     }
-    // 2. 硬件就绪后，再启动蓝牙
+    // 2. 硬件就绪后，再启动蓝牙 (连接回调用到的工作项要先初始化)
+    lat_wake_init();
     err = ble_setup_init();
     if (err) {
         LOG_ERR("Failed to init BLE: %d", err);
         return 0;
     }
 
+    // 3. 无连接状态广播，失败不影响连接功能
+    err = status_adv_init();
+    if (err) {
+        LOG_WRN("Status advertising unavailable: %d", err);
+    }
+
     LOG_INF("System Boot Complete.");
 
     // 主线程可以休眠，RTOS 会接管
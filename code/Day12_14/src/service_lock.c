@@ -10,6 +10,8 @@
 
 #include "service_lock.h"
 #include "app_lock.h"
+#include "lat_wake.h"
+#include "status_adv.h"
 
 LOG_MODULE_REGISTER(service_lock, LOG_LEVEL_INF);
 
@@ -30,6 +32,18 @@ static struct bt_uuid_128 lock_svc_uuid = BT_UUID_INIT_128(LOCK_SVC_UUID_VAL);
 static struct bt_uuid_128 lock_ctrl_uuid = BT_UUID_INIT_128(LOCK_CTRL_UUID_VAL);
 static struct bt_uuid_128 lock_status_uuid = BT_UUID_INIT_128(LOCK_STATUS_UUID_VAL);
 
+/* ---------------- 属性表下标 ---------------- */
+// 与下面 BT_GATT_SERVICE_DEFINE 的顺序一一对应，发送通知时直接按下标取属性
+enum {
+    LOCK_ATTR_SVC,
+    LOCK_ATTR_CTRL_CHRC,
+    LOCK_ATTR_CTRL_VALUE,
+    LOCK_ATTR_STATUS_CHRC,
+    LOCK_ATTR_STATUS_VALUE,
+    LOCK_ATTR_STATUS_CCC,
+    LOCK_ATTR_COUNT,
+};
+
 /* ---------------- 状态变量 ---------------- */
 static bool notify_enabled = false;
 static uint8_t current_lock_status = 0; // 0=Locked, 1=Unlocked
@@ -98,20 +112,44 @@ BT_GATT_SERVICE_DEFINE(smart_lock_svc,
     BT_GATT_CCC(lock_ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT),
 );
 
+// 增删属性后忘了改 LOCK_ATTR_* 下标，编译时报错
+BUILD_ASSERT(ARRAY_SIZE(attr_smart_lock_svc) == LOCK_ATTR_COUNT,
+             "smart_lock_svc 属性数量与 LOCK_ATTR_* 下标不一致");
+
+// 状态通知已发给对端：恢复从机延迟 (见 lat_wake.h)
+static void lock_status_sent(struct bt_conn *conn, void *user_data)
+{
+    lat_wake_release(conn);
+}
+
 /* ---------------- 对外接口 ---------------- */
 
 int service_lock_send_status(bool is_unlocked)
 {
+    struct bt_gatt_notify_params params = {
+        // 属性按下标直接取，不按 UUID 查找
+        .attr = &smart_lock_svc.attrs[LOCK_ATTR_STATUS_VALUE],
+        .data = &current_lock_status,
+        .len = sizeof(current_lock_status),
+        .func = lock_status_sent,
+    };
+    int err;
+
     current_lock_status = is_unlocked ? 1 : 0;
 
+    // 无连接状态广播同步更新，不管有没有手机订阅
+    status_adv_set_lock(is_unlocked);
+
     if (!notify_enabled) {
         return 0; // 客户端没订阅，无需发送
     }
 
-    // 发送 Notify
-    return bt_gatt_notify_uuid(NULL, 
-                           &lock_status_uuid.uuid, 
-                           smart_lock_svc.attrs, 
-                           &current_lock_status, 
-                           sizeof(current_lock_status));
+    // 先让控制器停止跳过连接事件，通知在下一个连接事件就能发出，
+    // 紧接着手机发来的命令也不用等从机延迟 (CONFIG_BT_MAX_CONN=1，NULL 即当前连接)
+    lat_wake_hold(NULL);
+    err = bt_gatt_notify_cb(NULL, &params);
+    if (err) {
+        lat_wake_release(NULL);
+    }
+    return err;
 }
\ No newline at end of file
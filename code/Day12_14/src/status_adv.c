@@ -0,0 +1,168 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include "status_adv.h"
+
+LOG_MODULE_REGISTER(status_adv, LOG_LEVEL_INF);
+
+/* ----------------配置参数---------------- */
+// 1: 主/辅助信道都用 Coded PHY (距离约 4 倍，需要 nRF52833/nRF52840)；
+// 0: 主信道 1M + 辅助信道 2M (空中时间最短)。控制器不支持 Coded 时自动退回 0
+#define STATUS_ADV_CODED        0
+
+// 扩展广播间隔: 1000ms - 1200ms (单位 0.625ms)，只给第一次发现的扫描端用
+#define STATUS_ADV_INT_MIN      1600
+#define STATUS_ADV_INT_MAX      1920
+
+// 周期广播间隔: 1000ms (单位 1.25ms)，同步后的扫描端只在这些时刻开接收窗口
+#define STATUS_PER_ADV_INT      800
+
+#define STATUS_ADV_COMPANY_ID   0xFFFF  // 未分配公司 ID，仅供测试
+#define STATUS_ADV_VERSION      1
+#define STATUS_FLAG_UNLOCKED    BIT(0)
+#define STATUS_BATTERY_UNKNOWN  0xFF
+
+/* ----------------全局变量---------------- */
+static struct bt_le_ext_adv *status_adv;
+
+// 由 set 接口写入，update_work 中编码
+static bool lock_unlocked;
+static uint8_t battery_level = STATUS_BATTERY_UNKNOWN;
+
+static uint16_t counter;
+static uint8_t record[7];
+
+// 扩展广播：名称 + 状态记录；周期广播：只有状态记录
+static const struct bt_data ad[] = {
+    BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME) - 1),
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, record, sizeof(record)),
+};
+
+static const struct bt_data per_ad[] = {
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, record, sizeof(record)),
+};
+
+/* ----------------记录编码---------------- */
+// 按当前状态编码记录，内容变化时计数加 1；返回 true 表示需要更新广播数据
+static bool record_encode(void)
+{
+    uint8_t flags = lock_unlocked ? STATUS_FLAG_UNLOCKED : 0;
+
+    if (record[2] == STATUS_ADV_VERSION && record[3] == flags && record[4] == battery_level) {
+        return false;
+    }
+
+    counter++;
+    sys_put_le16(STATUS_ADV_COMPANY_ID, &record[0]);
+    record[2] = STATUS_ADV_VERSION;
+    record[3] = flags;
+    record[4] = battery_level;
+    sys_put_le16(counter, &record[5]);
+    return true;
+}
+
+// 在 System WorkQueue 中原地更新两种广播的数据
+static void update_work_handler(struct k_work *work)
+{
+    int err;
+
+    if (!status_adv || !record_encode()) {
+        return;
+    }
+
+    err = bt_le_ext_adv_set_data(status_adv, ad, ARRAY_SIZE(ad), NULL, 0);
+    if (err) {
+        LOG_ERR("Failed to update ext adv data (err %d)", err);
+    }
+
+    err = bt_le_per_adv_set_data(status_adv, per_ad, ARRAY_SIZE(per_ad));
+    if (err) {
+        LOG_ERR("Failed to update periodic adv data (err %d)", err);
+    }
+
+    LOG_INF("Status record #%u: %s, battery %u%%", counter,
+            lock_unlocked ? "unlocked" : "locked", battery_level);
+}
+
+// 静态定义：电池采样在蓝牙初始化之前就会调用 status_adv_set_battery()
+static K_WORK_DEFINE(update_work, update_work_handler);
+
+/* ----------------对外接口实现---------------- */
+
+int status_adv_init(void)
+{
+    struct bt_le_adv_param param =
+        BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_EXT_ADV |
+                             (STATUS_ADV_CODED ? BT_LE_ADV_OPT_CODED : 0),
+                             STATUS_ADV_INT_MIN, STATUS_ADV_INT_MAX, NULL);
+    struct bt_le_ext_adv *adv;
+    int err;
+
+    // 1. 创建不可连接、不可扫描的扩展广播集 (周期广播的前提)
+    err = bt_le_ext_adv_create(&param, NULL, &adv);
+    if (err && (param.options & BT_LE_ADV_OPT_CODED)) {
+        LOG_WRN("Coded PHY not supported (err %d), using 1M/2M", err);
+        param.options &= ~BT_LE_ADV_OPT_CODED;
+        err = bt_le_ext_adv_create(&param, NULL, &adv);
+    }
+    if (err) {
+        LOG_ERR("Failed to create status adv set (err %d)", err);
+        return err;
+    }
+
+    // 2. 周期广播参数
+    err = bt_le_per_adv_set_param(adv,
+                                  BT_LE_PER_ADV_PARAM(STATUS_PER_ADV_INT, STATUS_PER_ADV_INT,
+                                                      BT_LE_PER_ADV_OPT_NONE));
+    if (err) {
+        LOG_ERR("Failed to set periodic adv params (err %d)", err);
+        return err;
+    }
+
+    // 3. 写入初始记录 (init 之前 set 进来的状态也在这里生效)
+    record_encode();
+    err = bt_le_ext_adv_set_data(adv, ad, ARRAY_SIZE(ad), NULL, 0);
+    if (!err) {
+        err = bt_le_per_adv_set_data(adv, per_ad, ARRAY_SIZE(per_ad));
+    }
+    if (err) {
+        LOG_ERR("Failed to set status adv data (err %d)", err);
+        return err;
+    }
+
+    // 4. 先开周期广播，再开扩展广播 (扩展广播里带 SyncInfo 指向周期广播)
+    err = bt_le_per_adv_start(adv);
+    if (err) {
+        LOG_ERR("Failed to start periodic adv (err %d)", err);
+        return err;
+    }
+
+    err = bt_le_ext_adv_start(adv, BT_LE_EXT_ADV_START_DEFAULT);
+    if (err) {
+        LOG_ERR("Failed to start status adv (err %d)", err);
+        return err;
+    }
+
+    // 启动完成后才交给 update_work，期间 set 进来的变化在这里补上
+    status_adv = adv;
+    k_work_submit(&update_work);
+
+    LOG_INF("Status advertising started (%s)",
+            (param.options & BT_LE_ADV_OPT_CODED) ? "Coded" : "1M/2M");
+    return 0;
+}
+
+void status_adv_set_lock(bool is_unlocked)
+{
+    lock_unlocked = is_unlocked;
+    k_work_submit(&update_work);
+}
+
+void status_adv_set_battery(uint8_t level)
+{
+    battery_level = level;
+    k_work_submit(&update_work);
+}
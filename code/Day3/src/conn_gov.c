@@ -0,0 +1,304 @@
+/*
+ * Module: Connection Parameter Governor
+ * Description: 按流量自动切换连接参数，实现见 conn_gov.h 说明
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "conn_gov.h"
+
+/* ----------------配置部分---------------- */
+
+/* 连接建立后多久开始调节 (原 Day3 固定 5 秒后才更新参数) */
+#define GOV_START_DELAY_MS      5000
+/* 采样周期 */
+#define GOV_SAMPLE_MS           500
+
+/* 迟滞阈值：升档门槛远高于降档门槛，避免在边界上来回切换 */
+#define GOV_UP_BPS              1000    // 速率 ≥ 1000 B/s 进入低延迟
+#define GOV_UP_DEPTH            128     // 或者待发送 ≥ 128 字节
+#define GOV_DOWN_BPS            200     // 速率 < 200 B/s ...
+#define GOV_DOWN_HOLD_MS        5000    // ... 且队列为空持续 5 秒才回到省电
+
+/* 限速：两次参数更新请求至少间隔 2 秒；请求 10 秒没有结果视为被拒绝 */
+#define GOV_MIN_UPDATE_MS       2000
+#define GOV_PENDING_TIMEOUT_MS  10000
+
+/*
+ * 能耗估算常数 (nRF52832 @ 3 V，按手册电流粗略折算，需用功耗分析仪校准)
+ * 一个连接事件：唤醒 + 收发空包约 2.5 uC ≈ 7.5 uJ
+ * 空口每字节：1M PHY 8 us × ~6 mA × 3 V ≈ 140 nJ
+ */
+#define GOV_EVENT_NJ            7500
+#define GOV_BYTE_NJ             140
+
+/*
+ * 两组连接参数 (BT_LE_CONN_PARAM_INIT(min, max, latency, timeout)，间隔单位 1.25 ms，超时单位 10 ms)
+ * 省电档的监督超时必须大于 (1 + latency) × interval × 2 = 1 s
+ * other 不是请求的参数，表示连接正在用对端选的参数 (刚连接时或对端主动修改后)
+ */
+static const struct gov_profile {
+    const char *name;
+    struct bt_le_conn_param param;
+} profiles[CONN_GOV_PROFILE_COUNT] = {
+    [CONN_GOV_PERF]  = { "perf",  BT_LE_CONN_PARAM_INIT(16, 16, 0, 40) },   // 20 ms，400 ms 超时
+    [CONN_GOV_POWER] = { "power", BT_LE_CONN_PARAM_INIT(80, 80, 4, 400) },  // 100 ms，跳过 4 个事件，4 s 超时
+    [CONN_GOV_OTHER] = { "other" },
+};
+
+/* ----------------每连接状态---------------- */
+
+struct gov_stats {
+    int64_t time_ms;        // 停留时间
+    uint64_t bytes;         // 收发字节数
+    uint64_t events;        // 估算的从机实际参加的连接事件数
+    uint32_t worst_us;      // 最坏情况延迟
+};
+
+struct gov_conn {
+    struct bt_conn *conn;
+    enum conn_gov_profile profile;  // 当前生效的档位
+    enum conn_gov_profile target;   // 最近一次请求的档位
+    bool pending;                   // 请求已发出，等待 le_param_updated
+    uint16_t interval;              // 当前实际参数
+    uint16_t latency;
+    int64_t last_req_ms;
+    int64_t sample_ms;
+    int64_t quiet_since_ms;         // 开始空闲的时间，0 表示不空闲
+    uint32_t rate_bps;              // 平滑后的速率
+    atomic_t bytes;                 // 本采样区间的字节数
+    struct gov_stats stats[CONN_GOV_PROFILE_COUNT];
+    struct k_work_delayable work;
+};
+
+static struct gov_conn gov_conns[CONFIG_BT_MAX_CONN];
+static conn_gov_depth_cb_t depth_cb;
+
+static struct gov_conn *gov_get(struct bt_conn *conn)
+{
+    struct gov_conn *gc = &gov_conns[bt_conn_index(conn)];
+
+    return gc->conn == conn ? gc : NULL;
+}
+
+/*
+ * 按实际参数判断落在哪一档：Interval 在该档范围内且 Latency 相同才算，
+ * 否则是 other (例如手机默认的 30-50 ms)，下一次采样会按流量请求一档
+ */
+static enum conn_gov_profile gov_classify(uint16_t interval, uint16_t latency)
+{
+    for (int i = 0; i < CONN_GOV_OTHER; i++) {
+        const struct bt_le_conn_param *param = &profiles[i].param;
+
+        if (interval >= param->interval_min && interval <= param->interval_max &&
+            latency == param->latency) {
+            return i;
+        }
+    }
+    return CONN_GOV_OTHER;
+}
+
+/* 把一个采样区间计入当前档位 */
+static void gov_account(struct gov_conn *gc, int64_t elapsed_ms, uint32_t bytes)
+{
+    struct gov_stats *st = &gc->stats[gc->profile];
+    uint32_t interval_us = gc->interval * 1250U;
+    /* 有数据的区间每个连接事件都要醒来，空闲时按从机延迟跳过 */
+    uint32_t skip = bytes ? 1 : (1U + gc->latency);
+
+    st->time_ms += elapsed_ms;
+    st->bytes += bytes;
+    if (interval_us) {
+        st->events += (uint64_t)elapsed_ms * 1000 / (interval_us * skip);
+    }
+    st->worst_us = MAX(st->worst_us, (1U + gc->latency) * interval_us);
+}
+
+static void gov_request(struct gov_conn *gc, enum conn_gov_profile want, int64_t now)
+{
+    int err;
+
+    if (gc->pending) {
+        if (now - gc->last_req_ms < GOV_PENDING_TIMEOUT_MS) {
+            return;
+        }
+        /* 对端没有接受，按当前档位继续，限速后重试 */
+        printk("[GOV] %s request timed out\n", profiles[gc->target].name);
+        gc->pending = false;
+        gc->target = gc->profile;
+    }
+    if (want == gc->profile || now - gc->last_req_ms < GOV_MIN_UPDATE_MS) {
+        return;
+    }
+
+    gc->last_req_ms = now;
+    err = bt_conn_le_param_update(gc->conn, &profiles[want].param);
+    if (err) {
+        printk("[GOV] %s request failed: %d\n", profiles[want].name, err);
+        return;
+    }
+
+    printk("[GOV] %s -> %s (rate %u B/s)\n", profiles[gc->profile].name,
+           profiles[want].name, gc->rate_bps);
+    gc->target = want;
+    gc->pending = true;
+}
+
+static void gov_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct gov_conn *gc = CONTAINER_OF(dwork, struct gov_conn, work);
+    int64_t now = k_uptime_get();
+    int64_t elapsed = now - gc->sample_ms;
+    enum conn_gov_profile want = gc->profile;
+    uint32_t bytes;
+    uint32_t depth;
+
+    if (!gc->conn) {
+        return;
+    }
+
+    bytes = atomic_clear(&gc->bytes);
+    depth = depth_cb ? depth_cb(gc->conn) : 0;
+    gc->sample_ms = now;
+    if (elapsed > 0) {
+        /* 1/4 权重的指数平滑，单个突发不会立刻拉满速率 */
+        gc->rate_bps = (gc->rate_bps * 3 + (uint32_t)(bytes * 1000ULL / elapsed)) / 4;
+        gov_account(gc, elapsed, bytes);
+    }
+
+    if (gc->rate_bps >= GOV_UP_BPS || depth >= GOV_UP_DEPTH) {
+        want = CONN_GOV_PERF;
+        gc->quiet_since_ms = 0;
+    } else if (gc->rate_bps < GOV_DOWN_BPS && depth == 0) {
+        if (!gc->quiet_since_ms) {
+            gc->quiet_since_ms = now;
+        }
+        /* 不在任何一档时没有需要保持的低延迟，不用等迟滞 */
+        if (gc->profile == CONN_GOV_OTHER || now - gc->quiet_since_ms >= GOV_DOWN_HOLD_MS) {
+            want = CONN_GOV_POWER;
+        }
+    } else {
+        gc->quiet_since_ms = 0;
+    }
+    /* 对端选的参数：有流量就请求低延迟档 */
+    if (want == CONN_GOV_OTHER) {
+        want = CONN_GOV_PERF;
+    }
+
+    gov_request(gc, want, now);
+
+    k_work_reschedule(&gc->work, K_MSEC(GOV_SAMPLE_MS));
+}
+
+/* ----------------连接回调---------------- */
+
+static void gov_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct gov_conn *gc = gov_get(conn);
+
+    if (!gc) {
+        return;
+    }
+
+    k_work_cancel_delayable(&gc->work);
+    conn_gov_report(conn);
+    bt_conn_unref(gc->conn);
+    gc->conn = NULL;
+}
+
+static void gov_param_updated(struct bt_conn *conn, uint16_t interval,
+                              uint16_t latency, uint16_t timeout)
+{
+    struct gov_conn *gc = gov_get(conn);
+    enum conn_gov_profile prev;
+
+    if (!gc) {
+        return;
+    }
+
+    prev = gc->profile;
+    gc->interval = interval;
+    gc->latency = latency;
+    gc->profile = gov_classify(interval, latency);
+    gc->target = gc->profile;
+    gc->pending = false;
+
+    if (gc->profile != prev) {
+        conn_gov_report(conn);
+    }
+}
+
+BT_CONN_CB_DEFINE(gov_conn_callbacks) = {
+    .disconnected = gov_disconnected,
+    .le_param_updated = gov_param_updated,
+};
+
+/* ----------------对外接口---------------- */
+
+void conn_gov_init(conn_gov_depth_cb_t depth)
+{
+    depth_cb = depth;
+    for (size_t i = 0; i < ARRAY_SIZE(gov_conns); i++) {
+        k_work_init_delayable(&gov_conns[i].work, gov_work_handler);
+    }
+}
+
+void conn_gov_start(struct bt_conn *conn)
+{
+    struct gov_conn *gc = &gov_conns[bt_conn_index(conn)];
+    struct bt_conn_info info;
+
+    if (gc->conn || bt_conn_get_info(conn, &info)) {
+        return;
+    }
+
+    memset(gc->stats, 0, sizeof(gc->stats));
+    gc->interval = info.le.interval;
+    gc->latency = info.le.latency;
+    gc->profile = gov_classify(gc->interval, gc->latency);
+    gc->target = gc->profile;
+    gc->pending = false;
+    gc->last_req_ms = 0;
+    gc->quiet_since_ms = 0;
+    gc->rate_bps = 0;
+    atomic_clear(&gc->bytes);
+    gc->conn = bt_conn_ref(conn);
+    gc->sample_ms = k_uptime_get() + GOV_START_DELAY_MS;
+
+    k_work_reschedule(&gc->work, K_MSEC(GOV_START_DELAY_MS));
+}
+
+void conn_gov_record(struct bt_conn *conn, uint32_t bytes)
+{
+    struct gov_conn *gc = gov_get(conn);
+
+    if (gc) {
+        atomic_add(&gc->bytes, bytes);
+    }
+}
+
+void conn_gov_report(struct bt_conn *conn)
+{
+    struct gov_conn *gc = gov_get(conn);
+
+    if (!gc) {
+        return;
+    }
+
+    for (int i = 0; i < CONN_GOV_PROFILE_COUNT; i++) {
+        const struct gov_stats *st = &gc->stats[i];
+        uint64_t energy_nj = st->events * GOV_EVENT_NJ + st->bytes * GOV_BYTE_NJ;
+
+        if (!st->time_ms) {
+            continue;
+        }
+        printk("[GOV] %-5s: %lld ms, %llu bytes, %llu events, ~%llu uJ, %llu nJ/byte, worst %u ms\n",
+               profiles[i].name, st->time_ms, st->bytes, st->events, energy_nj / 1000,
+               st->bytes ? energy_nj / st->bytes : 0, st->worst_us / 1000);
+    }
+}
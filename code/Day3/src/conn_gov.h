@@ -0,0 +1,62 @@
+/*
+ * Module: Connection Parameter Governor
+ * Description: 按流量自动在低延迟和省电两组连接参数之间切换
+ *
+ * 每个连接每 GOV_SAMPLE_MS 采样一次：区间流量 (字节/秒，平滑后) 和调用者的发送队列深度。
+ *   省电 → 低延迟: 速率 ≥ GOV_UP_BPS，或队列深度 ≥ GOV_UP_DEPTH (一次采样就切换)
+ *   低延迟 → 省电: 速率 < GOV_DOWN_BPS 且队列为空，持续 GOV_DOWN_HOLD_MS (迟滞)
+ *   对端选的参数 (不属于任何一档): 第一次采样就按流量请求其中一档
+ * 两次 bt_conn_le_param_update 之间至少间隔 GOV_MIN_UPDATE_MS，
+ * 上一次请求还没有结果时不发新请求。
+ *
+ * 每个档位统计停留时间、字节数、估算的连接事件数，并打印：
+ *   nJ/byte   估算能耗 / 字节 (连接事件 + 空口字节，常数见 conn_gov.c 配置部分)
+ *   worst     最坏情况延迟 (1 + latency) × interval：对端发来的数据最多等这么久
+ * 切换档位和连接断开时打印。
+ */
+
+#ifndef CONN_GOV_H_
+#define CONN_GOV_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief 连接参数档位 */
+enum conn_gov_profile {
+    CONN_GOV_PERF,      /**< 低延迟：20 ms 间隔，无从机延迟 */
+    CONN_GOV_POWER,     /**< 省电：100 ms 间隔，从机延迟 4 */
+    CONN_GOV_OTHER,     /**< 不属于以上两档 (对端选的参数)，只统计，不会请求 */
+    CONN_GOV_PROFILE_COUNT,
+};
+
+/**
+ * @brief 查询某个连接当前待发送的字节数 (发送队列深度)
+ *
+ * 在 System WorkQueue 中调用，不能阻塞。
+ */
+typedef uint32_t (*conn_gov_depth_cb_t)(struct bt_conn *conn);
+
+/**
+ * @brief 初始化模块
+ * @param depth 队列深度回调 (可为 NULL，只按流量判断)
+ */
+void conn_gov_init(conn_gov_depth_cb_t depth);
+
+/**
+ * @brief 开始调节某个连接 (在 connected 回调中调用)
+ *
+ * 连接建立后先等 5 秒 (让对端完成服务发现等操作)，再开始采样和切换。
+ */
+void conn_gov_start(struct bt_conn *conn);
+
+/**
+ * @brief 记录该连接上收发的字节数 (可在任意线程中调用)
+ */
+void conn_gov_record(struct bt_conn *conn, uint32_t bytes);
+
+/**
+ * @brief 打印该连接每个档位的统计
+ */
+void conn_gov_report(struct bt_conn *conn);
+
+#endif /* CONN_GOV_H_ */
@@ -12,6 +12,11 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
 
+#include "conn_gov.h"
+#include "traffic_demo.h"
+#include "phy_mgr.h"
+#include "lat_wake.h"
+
 /* ----------------配置区域---------------- */
 
 /*
@@ -60,23 +65,13 @@
 static const struct gpio_dt_spec led = GPIO_DT_SPEC_GET(LED0_NODE, gpios);
 
 /*
- * 定义连接参数
- * 
- * 宏: BT_LE_CONN_PARAM(min, max, latency, timeout)
- * 功能: 创建连接参数结构体
- * 参数1: min - 最小连接间隔 (单位 1.25ms)
- * 参数2: max - 最大连接间隔 (单位 1.25ms)
- * 参数3: latency - 从设备延迟 (Slave Latency)，允许跳过的连接事件数
- * 参数4: timeout - 监督超时 (单位 10ms)
- * 
- * 本例参数:
- * - Interval: 20ms (16 * 1.25 = 20ms)
- * - Latency: 0 (不跳过任何连接事件)
- * - Timeout: 400ms (40 * 10 = 400ms)
+ * 连接参数
  * 
- * 注意: 连接参数需要双方协商，实际值可能不同
+ * 不再固定使用一组参数，而是交给 conn_gov 模块按流量在两档之间切换:
+ * - perf:  Interval 20ms, Latency 0, Timeout 400ms (原来的固定参数)
+ * - power: Interval 100ms, Latency 4, Timeout 4s
+ * 两组参数和切换阈值见 conn_gov.c 的配置部分
  */
-static struct bt_le_conn_param *my_conn_params = BT_LE_CONN_PARAM(16, 16, 0, 40);
 
 /*
  * 全局变量：保存当前连接句柄
@@ -90,60 +85,6 @@ static struct bt_conn *current_conn;
 
 static void start_advertising(void);
 
-/* ----------------工作项：5秒后更新参数---------------- */
-
-/*
- * 工作项结构体
- * 
- * struct k_work_delayable: 可延时的工作项，用于在指定时间后执行任务
- * 用途: 在连接建立 5 秒后，请求更新连接参数
- * 
- * 工作队列机制:
- * - Zephyr 使用工作队列来处理需要在上下文之外执行的任务
- * - 延时工作项可以指定延迟时间，时间到后自动提交到系统工作队列
- */
-struct k_work_delayable update_params_work;
-
-/*
- * 工作项处理函数
- * 
- * 原型: void work_handler(struct k_work *work)
- * 参数: work - 指向触发的工作项结构体
- * 
- * API: k_work_cancel_delayable(work)
- * 功能: 取消一个已调度但未执行的延时工作项
- * 参数: work - 指向工作项结构体
- * 返回值: 0 表示成功取消，负数表示工作项正在执行或已完成
- */
-static void update_params_handler(struct k_work *work)
-{
-    int err;
-    if (!current_conn) {
-        return;
-    }
-
-    printk("Work Triggered: Requesting Connection Param Update...\n");
-
-    /*
-     * 发起参数更新请求
-     * 
-     * API: bt_conn_le_param_update(conn, param)
-     * 功能: 请求更新连接参数
-     * 参数1: conn - 连接对象指针
-     * 参数2: param - 指向连接参数结构体
-     * 返回值: 0 表示请求已发送，负数表示错误
-     * 
-     * 注意: 此函数只是发送请求，实际参数更新由双方协商决定
-     *       协商结果会通过 le_param_updated 回调通知
-     */
-    err = bt_conn_le_param_update(current_conn, my_conn_params);
-    if (err) {
-        printk("Connection param update failed: %d\n", err);
-    } else {
-        printk("Connection param update requested success.\n");
-    }
-}
-
 /*
  * 连接建立回调
  * 
@@ -177,60 +118,34 @@ static void connected(struct bt_conn *conn, uint8_t err)
     printk("LED ON\n");
     gpio_pin_set_dt(&led, 1);
 
-    /* 任务 3：请求切换到 2M PHY (NCS v2.7.0 新写法) */
+    /* 任务 3：按链路质量选择 PHY (2M → 1M → Coded S2 → Coded S8) */
     
     /*
-     * 定义 PHY 参数结构体
-     * 
-     * struct bt_conn_le_phy_param: PHY 更新参数结构体
-     * 成员:
-     * - options: PHY 选项，通常设为 BT_CONN_LE_PHY_OPT_NONE
-     * - pref_tx_phy: 首选的发送 PHY 模式
-     * - pref_rx_phy: 首选的接收 PHY 模式
+     * API: phy_mgr_start(conn)
+     * 功能: 开始管理该连接的 PHY
+     *       不再无条件请求 2M：距离拉远时 2M 最先到灵敏度极限，重传增多直至监督超时断开
+     *       模块每 500ms 读一次 RSSI (以及控制器的误包统计)，质量变差逐级降级，恢复后逐级升回
      * 
-     * PHY 模式选项:
-     * - BT_GAP_LE_PHY_1M: 1 Mbps 物理层
-     * - BT_GAP_LE_PHY_2M: 2 Mbps 物理层 (Bluetooth 5.0)
-     * - BT_GAP_LE_PHY_CODED: 编码 PHY (未来扩展)
+     * 注意: 真正的 PHY 更新请求仍然是 bt_conn_le_phy_update()，
+     *       参数是 struct bt_conn_le_phy_param (options 选择 Coded S2/S8)，
+     *       结果同样通过 le_phy_updated 回调通知
      */
-    const struct bt_conn_le_phy_param param = {
-        .options = BT_CONN_LE_PHY_OPT_NONE,
-        .pref_tx_phy = BT_GAP_LE_PHY_2M,
-        .pref_rx_phy = BT_GAP_LE_PHY_2M,
-    };
+    phy_mgr_start(conn);
 
-    /*
-     * 发起 PHY 更新请求
-     * 
-     * API: bt_conn_le_phy_update(conn, param)
-     * 功能: 请求更新连接的 PHY 模式
-     * 参数1: conn - 连接对象指针
-     * 参数2: param - 指向 PHY 参数结构体
-     * 返回值: 0 表示请求已发送，负数表示错误
-     * 
-     * 注意: 此函数只是发送请求，实际 PHY 更新由双方协商决定
-     *       协商结果会通过 le_phy_updated 回调通知
-     */
-    int phy_err = bt_conn_le_phy_update(conn, &param);
-    
-    if (phy_err) {
-        printk("PHY update request failed: %d\n", phy_err);
-    } else {
-        printk("PHY update to 2M requested.\n");
-    }
-
-    /* 任务 2：启动 5 秒延时，准备修改连接间隔 */
+    /* 任务 2：5 秒后由连接参数调节器接管连接间隔 */
     
     /*
-     * API: k_work_schedule(work, delay)
-     * 功能: 调度一个工作项在指定时间后执行
-     * 参数1: work - 指向工作项结构体
-     * 参数2: delay - 延迟时间，K_SECONDS(5) 表示 5 秒
-     * 返回值: 0 表示成功，负数表示工作项已在队列中
+     * API: conn_gov_start(conn)
+     * 功能: 开始按流量调节该连接的参数
+     *       每 500ms 采样一次流量和队列深度，带迟滞地在 perf / power 两档之间切换，
+     *       并限制 bt_conn_le_param_update 的调用频率
      * 
-     * 注意: 延时工作项会自动提交到系统工作队列
+     * 注意: 断开时模块会自己停止并打印每档的能耗和最坏延迟统计
      */
-    k_work_schedule(&update_params_work, K_SECONDS(5));
+    conn_gov_start(conn);
+
+    /* 演示用流量源：对端打开通知后周期性地突发发送 */
+    traffic_demo_start(conn);
 }
 
 /*
@@ -260,8 +175,8 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     printk("LED OFF\n");
     gpio_pin_set_dt(&led, 0);
 
-    /* 取消未执行的工作项 */
-    k_work_cancel_delayable(&update_params_work);
+    /* 停止演示流量 (conn_gov 自己监听断开事件) */
+    traffic_demo_stop();
 
     /* 断开后重新广播，保持设备可见 */
     start_advertising();
@@ -285,6 +200,19 @@ static void le_param_updated(struct bt_conn *conn, uint16_t interval,
            interval, interval * 1.25, latency, timeout * 10);
 }
 
+/* PHY 模式值转成字符串 (Coded 不区分 S2/S8) */
+static const char *phy_name(uint8_t phy)
+{
+    switch (phy) {
+    case BT_GAP_LE_PHY_2M:
+        return "2M";
+    case BT_GAP_LE_PHY_CODED:
+        return "Coded";
+    default:
+        return "1M";
+    }
+}
+
 /*
  * 监听 PHY 更新结果的回调
  * 
@@ -305,9 +233,7 @@ static void le_param_updated(struct bt_conn *conn, uint16_t interval,
 static void le_phy_updated(struct bt_conn *conn,
                            struct bt_conn_le_phy_info *param)
 {
-    printk("PHY updated: TX %dM, RX %dM\n", 
-           (param->tx_phy == BT_GAP_LE_PHY_2M) ? 2 : 1,
-           (param->rx_phy == BT_GAP_LE_PHY_2M) ? 2 : 1);
+    printk("PHY updated: TX %s, RX %s\n", phy_name(param->tx_phy), phy_name(param->rx_phy));
 }
 
 /*
@@ -417,16 +343,17 @@ int main(void)
     }
 
     /*
-     * 初始化工作队列
-     * 
-     * API: k_work_init_delayable(work, handler)
-     * 功能: 初始化一个可延时的工作项
-     * 参数1: work - 指向工作项结构体
-     * 参数2: handler - 工作项处理函数指针
+     * 初始化连接参数调节器
      * 
-     * 注意: 必须在使用工作项之前调用此函数
+     * API: conn_gov_init(depth)
+     * 功能: 初始化每个连接的采样工作项
+     * 参数: depth - 查询发送队列深度的回调，这里用演示流量源的队列
      */
-    k_work_init_delayable(&update_params_work, update_params_handler);
+    conn_gov_init(traffic_demo_depth);
+
+    /* 演示流量源和 "有数据就醒" 模块的工作项只初始化一次，每次连接复用 */
+    traffic_demo_init();
+    lat_wake_init();
 
     /*
      * 初始化蓝牙栈
@@ -444,6 +371,9 @@ int main(void)
 
     printk("Bluetooth initialized\n");
 
+    /* PHY 管理器：要在 bt_enable 之后打开控制器的误包统计 (QoS 连接事件报告) */
+    phy_mgr_init();
+
     start_advertising();
 
     return 0;
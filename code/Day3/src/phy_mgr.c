@@ -0,0 +1,417 @@
+/*
+ * Module: PHY Manager
+ * Description: 按链路质量自动选择 PHY，判断规则见 phy_mgr.h
+ *
+ * 所有 HCI 命令 (Read RSSI、PHY 更新) 都在 System WorkQueue 中发出；
+ * QoS 报告在蓝牙 RX 上下文中到达，只累加原子计数，采样时取走清零。
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/logging/log.h>
+
+#if defined(CONFIG_BT_LL_SOFTDEVICE) && defined(CONFIG_BT_HCI_VS_EVT_USER)
+#include <sdc_hci_vs.h>
+#define PHY_MGR_QOS 1
+#else
+#define PHY_MGR_QOS 0
+#endif
+
+#include "phy_mgr.h"
+
+LOG_MODULE_REGISTER(phy_mgr, LOG_LEVEL_INF);
+
+/* ----------------配置部分---------------- */
+#define PHY_MGR_SAMPLE_MS       500     // 采样周期
+#define PHY_MGR_DOWN_SAMPLES    2       // 连续 2 次 (1 s) 变差就降级
+#define PHY_MGR_UP_SAMPLES      10      // 连续 10 次 (5 s) 变好才升级
+#define PHY_MGR_ERR_DOWN_PCT    10      // 误包率 ≥ 10% 降级
+#define PHY_MGR_ERR_UP_PCT      2       // 误包率 ≤ 2% 才允许升级
+#define PHY_MGR_MIN_PKTS        20      // 区间内包数太少时误包率不参与判断
+#define PHY_MGR_UPDATE_TIMEOUT  3000    // PHY 更新请求等待完成回调的时间 (ms)
+
+/*
+ * 每级的 RSSI 门限 (dBm)，按接收灵敏度留余量 (nRF52832: 2M -93、1M -96；
+ * Coded 只有 nRF52833/52840 等支持，S2 -100、S8 -103)。
+ * 本端或对端不支持 Coded 时 S2/S8 两级不会用到，最低停在 1M
+ * leave: 低于它离开本级 (降一级)；enter: 从下一级升回本级需要高于它 (比 leave 高 6 dB)
+ */
+enum phy_level {
+    PHY_LEVEL_2M,
+    PHY_LEVEL_1M,
+    PHY_LEVEL_S2,
+    PHY_LEVEL_S8,
+    PHY_LEVEL_COUNT,
+};
+
+static const struct phy_level_cfg {
+    const char *name;
+    uint8_t phy;            // BT_GAP_LE_PHY_*
+    uint16_t options;       // BT_CONN_LE_PHY_OPT_*
+    int8_t leave_rssi;
+    int8_t enter_rssi;
+} levels[PHY_LEVEL_COUNT] = {
+    [PHY_LEVEL_2M] = { "2M", BT_GAP_LE_PHY_2M,    BT_CONN_LE_PHY_OPT_NONE,     -80, -74 },
+    [PHY_LEVEL_1M] = { "1M", BT_GAP_LE_PHY_1M,    BT_CONN_LE_PHY_OPT_NONE,     -87, -81 },
+    [PHY_LEVEL_S2] = { "S2", BT_GAP_LE_PHY_CODED, BT_CONN_LE_PHY_OPT_CODED_S2, -92, -86 },
+    [PHY_LEVEL_S8] = { "S8", BT_GAP_LE_PHY_CODED, BT_CONN_LE_PHY_OPT_CODED_S8, INT8_MIN, -90 },
+};
+
+/* 每个连接的状态 (按 bt_conn_index 索引) */
+struct phy_mgr {
+    struct bt_conn *conn;
+    uint16_t handle;                /* HCI 连接句柄，用来匹配 QoS 报告 */
+    enum phy_level level;           /* 当前生效的级别 */
+    enum phy_level requested;       /* 正在请求的级别 */
+    bool pending;
+    bool coded_ok;                  /* 请求 Coded 失败后置 false，不再尝试 */
+    int64_t req_ms;
+    int64_t level_ms;               /* 进入当前级别的时间 */
+    int32_t rssi_x4;                /* 平滑后的 RSSI × 4 */
+    bool rssi_valid;
+    uint8_t bad_samples;
+    uint8_t good_samples;
+    uint32_t changes;
+    int64_t time_ms[PHY_LEVEL_COUNT];
+    /* QoS 报告累计 (蓝牙 RX 上下文写入) */
+    atomic_t qos_pkts;
+    atomic_t qos_errs;
+    struct k_work_delayable work;
+};
+
+static struct phy_mgr phy_mgrs[CONFIG_BT_MAX_CONN];
+
+static const struct bt_conn_le_phy_param *level_param(enum phy_level level,
+                                                      struct bt_conn_le_phy_param *param)
+{
+    param->options = levels[level].options;
+    param->pref_tx_phy = levels[level].phy;
+    param->pref_rx_phy = levels[level].phy;
+    return param;
+}
+
+static int read_rssi(struct phy_mgr *pm, int8_t *rssi)
+{
+    struct bt_hci_cp_read_rssi *cp;
+    struct bt_hci_rp_read_rssi *rp;
+    struct net_buf *buf;
+    struct net_buf *rsp = NULL;
+    int err;
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle = sys_cpu_to_le16(pm->handle);
+
+    err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
+    if (err) {
+        return err;
+    }
+    rp = (void *)rsp->data;
+    *rssi = rp->rssi;
+    net_buf_unref(rsp);
+    return 0;
+}
+
+#if PHY_MGR_QOS
+/* 每个连接事件一条报告：统计本端收发的包和其中出错的包 */
+static bool qos_evt(struct net_buf_simple *buf)
+{
+    const sdc_hci_subevent_vs_qos_conn_event_report_t *evt;
+    uint32_t pkts;
+    uint32_t errs;
+
+    if (buf->len < 1 + sizeof(*evt) || buf->data[0] != SDC_HCI_SUBEVENT_VS_QOS_CONN_EVENT_REPORT) {
+        return false;
+    }
+    evt = (const void *)&buf->data[1];
+
+    for (int i = 0; i < ARRAY_SIZE(phy_mgrs); i++) {
+        struct phy_mgr *pm = &phy_mgrs[i];
+
+        if (!pm->conn || pm->handle != sys_le16_to_cpu(evt->conn_handle)) {
+            continue;
+        }
+        /* CRC 错误的接收包 + 对端没确认 (要重传) 的发送包 */
+        errs = evt->rx_crc_error_count + (evt->tx_packet_count - evt->tx_ack_count);
+        pkts = evt->rx_packet_count + evt->tx_packet_count;
+        /* 对端一个包都没收到 (CRC 错误的也没有) 算一次丢失的连接事件 */
+        if (evt->rx_packet_count == 0 && evt->rx_crc_error_count == 0) {
+            errs++;
+            pkts++;
+        }
+        atomic_add(&pm->qos_pkts, pkts);
+        atomic_add(&pm->qos_errs, errs);
+        break;
+    }
+    return true;
+}
+
+static int qos_enable(void)
+{
+    sdc_hci_cmd_vs_qos_conn_event_report_enable_t *cp;
+    struct net_buf *buf;
+    int err;
+
+    err = bt_hci_register_vnd_evt_cb(qos_evt);
+    if (err) {
+        return err;
+    }
+    buf = bt_hci_cmd_create(SDC_HCI_OPCODE_CMD_VS_QOS_CONN_EVENT_REPORT_ENABLE, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->enable = 1;
+    return bt_hci_cmd_send_sync(SDC_HCI_OPCODE_CMD_VS_QOS_CONN_EVENT_REPORT_ENABLE, buf, NULL);
+}
+#endif /* PHY_MGR_QOS */
+
+static void level_enter(struct phy_mgr *pm, enum phy_level level)
+{
+    int64_t now = k_uptime_get();
+
+    pm->time_ms[pm->level] += now - pm->level_ms;
+    pm->level_ms = now;
+    pm->level = level;
+    pm->bad_samples = 0;
+    pm->good_samples = 0;
+}
+
+static void request_level(struct phy_mgr *pm, enum phy_level level, uint32_t err_pct)
+{
+    struct bt_conn_le_phy_param param;
+    int err;
+
+    err = bt_conn_le_phy_update(pm->conn, level_param(level, &param));
+    if (err) {
+        LOG_WRN("PHY %s request failed (err %d)", levels[level].name, err);
+        /* 请求被拒 (例如控制器不支持 Coded)：不再每个采样周期重试 */
+        if (levels[level].phy == BT_GAP_LE_PHY_CODED) {
+            pm->coded_ok = false;
+        }
+        return;
+    }
+
+    printk("[PHY %u] %s -> %s (rssi %d, err %u%%)\n", bt_conn_index(pm->conn),
+           levels[pm->level].name, levels[level].name, pm->rssi_x4 / 4, err_pct);
+    pm->requested = level;
+    pm->pending = true;
+    pm->req_ms = k_uptime_get();
+}
+
+/* 采样一次，返回误包率 (百分比)，包数不够时返回 -1 */
+static int sample_quality(struct phy_mgr *pm)
+{
+    uint32_t pkts = atomic_clear(&pm->qos_pkts);
+    uint32_t errs = atomic_clear(&pm->qos_errs);
+    int8_t rssi;
+
+    /* 127 表示控制器读不到 RSSI */
+    if (read_rssi(pm, &rssi) == 0 && rssi != 127) {
+        if (!pm->rssi_valid) {
+            pm->rssi_x4 = rssi * 4;
+            pm->rssi_valid = true;
+        } else {
+            /* 1/4 权重的指数平滑，过滤单个连接事件的衰落 */
+            pm->rssi_x4 += rssi - pm->rssi_x4 / 4;
+        }
+    }
+
+    if (pkts < PHY_MGR_MIN_PKTS) {
+        return -1;
+    }
+    return MIN(errs, pkts) * 100 / pkts;
+}
+
+static void phy_mgr_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct phy_mgr *pm = CONTAINER_OF(dwork, struct phy_mgr, work);
+    enum phy_level up = pm->level - 1;
+    enum phy_level down = pm->level + 1;
+    int rssi;
+    int err_pct;
+    bool bad;
+    bool good;
+
+    if (!pm->conn) {
+        return;
+    }
+
+    err_pct = sample_quality(pm);
+    rssi = pm->rssi_x4 / 4;
+    k_work_reschedule(&pm->work, K_MSEC(PHY_MGR_SAMPLE_MS));
+
+    if (pm->pending) {
+        if (k_uptime_get() - pm->req_ms < PHY_MGR_UPDATE_TIMEOUT) {
+            return;
+        }
+        /* 没有完成回调：对端或本端不支持该 PHY */
+        LOG_WRN("PHY %s request timed out", levels[pm->requested].name);
+        if (levels[pm->requested].phy == BT_GAP_LE_PHY_CODED) {
+            pm->coded_ok = false;
+        }
+        pm->pending = false;
+    }
+
+    bad = (pm->rssi_valid && rssi < levels[pm->level].leave_rssi) ||
+          err_pct >= PHY_MGR_ERR_DOWN_PCT;
+    good = pm->level > PHY_LEVEL_2M && pm->rssi_valid && rssi >= levels[up].enter_rssi &&
+           err_pct <= PHY_MGR_ERR_UP_PCT;
+
+    pm->bad_samples = bad ? pm->bad_samples + 1 : 0;
+    pm->good_samples = good ? pm->good_samples + 1 : 0;
+
+    if (pm->bad_samples >= PHY_MGR_DOWN_SAMPLES && down < PHY_LEVEL_COUNT &&
+        (levels[down].phy != BT_GAP_LE_PHY_CODED || pm->coded_ok)) {
+        request_level(pm, down, MAX(err_pct, 0));
+    } else if (pm->good_samples >= PHY_MGR_UP_SAMPLES) {
+        request_level(pm, up, MAX(err_pct, 0));
+    }
+}
+
+static void phy_mgr_report(struct phy_mgr *pm)
+{
+    level_enter(pm, pm->level);
+
+    printk("[PHY %u] %u changes, time", bt_conn_index(pm->conn), pm->changes);
+    for (int i = 0; i < PHY_LEVEL_COUNT; i++) {
+        printk(" %s %lld ms", levels[i].name, pm->time_ms[i]);
+    }
+    printk("\n");
+}
+
+/* ----------------连接回调---------------- */
+
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    struct phy_mgr *pm = &phy_mgrs[bt_conn_index(conn)];
+    enum phy_level level;
+
+    if (pm->conn != conn) {
+        return;
+    }
+
+    switch (param->tx_phy) {
+    case BT_GAP_LE_PHY_2M:
+        level = PHY_LEVEL_2M;
+        break;
+    case BT_GAP_LE_PHY_CODED:
+        /* 完成事件不区分 S2/S8，以请求的为准 */
+        level = levels[pm->requested].phy == BT_GAP_LE_PHY_CODED ? pm->requested : PHY_LEVEL_S8;
+        break;
+    default:
+        level = PHY_LEVEL_1M;
+        break;
+    }
+
+    /* 请求 Coded 却还是 1M：对端不支持 */
+    if (pm->pending && levels[pm->requested].phy == BT_GAP_LE_PHY_CODED &&
+        param->tx_phy != BT_GAP_LE_PHY_CODED) {
+        LOG_WRN("Peer does not support Coded PHY");
+        pm->coded_ok = false;
+    }
+
+    pm->pending = false;
+    if (level != pm->level) {
+        pm->changes++;
+        level_enter(pm, level);
+    }
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct phy_mgr *pm = &phy_mgrs[bt_conn_index(conn)];
+
+    if (pm->conn != conn) {
+        return;
+    }
+
+    k_work_cancel_delayable(&pm->work);
+    phy_mgr_report(pm);
+    bt_conn_unref(pm->conn);
+    pm->conn = NULL;
+}
+
+BT_CONN_CB_DEFINE(phy_mgr_conn_callbacks) = {
+    .disconnected = disconnected,
+    .le_phy_updated = le_phy_updated,
+};
+
+/* ----------------对外接口---------------- */
+
+void phy_mgr_init(void)
+{
+    int err = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(phy_mgrs); i++) {
+        k_work_init_delayable(&phy_mgrs[i].work, phy_mgr_work_handler);
+    }
+
+#if PHY_MGR_QOS
+    err = qos_enable();
+#endif
+    if (err) {
+        LOG_WRN("QoS connection event reports unavailable (err %d), using RSSI only", err);
+    }
+}
+
+/* 本端控制器和对端都支持 LE Coded PHY 才允许降到 S2/S8 */
+static bool coded_supported(struct bt_conn *conn)
+{
+    struct bt_conn_remote_info rinfo;
+
+    if (!IS_ENABLED(CONFIG_BT_CTLR_PHY_CODED)) {
+        return false;               /* nRF52832 等没有 Coded PHY */
+    }
+    /* 对端特性还没交换完：先允许，请求失败或超时后再关闭 */
+    if (bt_conn_get_remote_info(conn, &rinfo) || !rinfo.le.features) {
+        return true;
+    }
+    return BT_FEAT_LE_PHY_CODED(rinfo.le.features);
+}
+
+void phy_mgr_start(struct bt_conn *conn)
+{
+    struct phy_mgr *pm = &phy_mgrs[bt_conn_index(conn)];
+    struct bt_conn_info info;
+
+    if (pm->conn || bt_conn_get_info(conn, &info) || bt_hci_get_conn_handle(conn, &pm->handle)) {
+        return;
+    }
+
+    switch (info.le.phy->tx_phy) {
+    case BT_GAP_LE_PHY_2M:
+        pm->level = PHY_LEVEL_2M;
+        break;
+    case BT_GAP_LE_PHY_CODED:
+        pm->level = PHY_LEVEL_S8;
+        break;
+    default:
+        pm->level = PHY_LEVEL_1M;
+        break;
+    }
+    pm->requested = pm->level;
+    pm->pending = false;
+    pm->coded_ok = coded_supported(conn);
+    pm->rssi_valid = false;
+    pm->bad_samples = 0;
+    /* 开始时不等满 5 秒：第一次采样质量够好就直接升级 (例如还停在连接时的 1M) */
+    pm->good_samples = PHY_MGR_UP_SAMPLES - 1;
+    pm->changes = 0;
+    memset(pm->time_ms, 0, sizeof(pm->time_ms));
+    pm->level_ms = k_uptime_get();
+    atomic_clear(&pm->qos_pkts);
+    atomic_clear(&pm->qos_errs);
+    pm->conn = bt_conn_ref(conn);
+
+    k_work_reschedule(&pm->work, K_MSEC(PHY_MGR_SAMPLE_MS));
+}
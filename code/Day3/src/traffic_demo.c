@@ -0,0 +1,162 @@
+/*
+ * Module: Traffic Demo
+ * Description: 演示用流量源，周期性突发通知，节奏见 traffic_demo.h
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include "conn_gov.h"
+#include "lat_wake.h"
+#include "traffic_demo.h"
+
+/* ----------------配置部分---------------- */
+
+#define DEMO_TICK_MS        10
+#define DEMO_CHUNK          30      // 每 tick 30 字节 → 突发期间约 3000 B/s
+#define DEMO_QUEUE_MAX      1024    // 队列满了就丢弃新数据
+#define DEMO_BURST_MS       10000
+#define DEMO_IDLE_MS        20000
+#define DEMO_PKT_MAX        244     // 单个通知的最大负载 (MTU 247 - 3)
+
+/* 自定义 128 位 UUID */
+#define BT_UUID_DEMO_SVC_VAL \
+    BT_UUID_128_ENCODE(0x7a3e0001, 0x5c1d, 0x4b8e, 0x9f21, 0x6d0c3a5b4e10)
+#define BT_UUID_DEMO_DATA_VAL \
+    BT_UUID_128_ENCODE(0x7a3e0002, 0x5c1d, 0x4b8e, 0x9f21, 0x6d0c3a5b4e10)
+
+#define BT_UUID_DEMO_SVC    BT_UUID_DECLARE_128(BT_UUID_DEMO_SVC_VAL)
+#define BT_UUID_DEMO_DATA   BT_UUID_DECLARE_128(BT_UUID_DEMO_DATA_VAL)
+
+/* ----------------GATT 服务---------------- */
+
+static bool notify_enabled;
+
+static void demo_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+    printk("[DEMO] notify %s\n", notify_enabled ? "on" : "off");
+}
+
+BT_GATT_SERVICE_DEFINE(demo_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_DEMO_SVC),
+    BT_GATT_CHARACTERISTIC(BT_UUID_DEMO_DATA, BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(demo_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+);
+
+/* demo_svc 中的属性位置 */
+enum {
+    DEMO_ATTR_SVC,
+    DEMO_ATTR_DATA_CHRC,
+    DEMO_ATTR_DATA_VALUE,
+    DEMO_ATTR_DATA_CCC,
+    DEMO_ATTR_COUNT,
+};
+BUILD_ASSERT(ARRAY_SIZE(attr_demo_svc) == DEMO_ATTR_COUNT, "demo_svc attribute layout changed");
+
+/* ----------------流量发生---------------- */
+
+static struct bt_conn *demo_conn;
+static uint32_t queued;         // 队列中待发送的字节数 (内容只是计数，不需要真正存数据)
+static uint8_t next_byte;
+static int64_t phase_start_ms;
+static bool bursting;
+static struct k_work_delayable tick_work;
+
+static void demo_flush(void)
+{
+    uint8_t buf[DEMO_PKT_MAX];
+    uint16_t len;
+
+    while (queued) {
+        len = MIN(queued, MIN(bt_gatt_get_mtu(demo_conn) - 3, DEMO_PKT_MAX));
+        for (uint16_t i = 0; i < len; i++) {
+            buf[i] = next_byte + i;
+        }
+        /* 协议栈缓冲区满时返回 -ENOMEM，剩下的留在队列里下次再发 */
+        if (bt_gatt_notify(demo_conn, &demo_svc.attrs[DEMO_ATTR_DATA_VALUE], buf, len)) {
+            break;
+        }
+        next_byte += len;
+        queued -= len;
+        conn_gov_record(demo_conn, len);
+    }
+}
+
+static void tick_work_handler(struct k_work *work)
+{
+    int64_t now = k_uptime_get();
+
+    if (!demo_conn) {
+        return;
+    }
+
+    if (now - phase_start_ms >= (bursting ? DEMO_BURST_MS : DEMO_IDLE_MS)) {
+        bursting = !bursting;
+        phase_start_ms = now;
+        printk("[DEMO] %s\n", bursting ? "burst" : "idle");
+    }
+
+    /* 发送中途关闭了通知：剩下的数据丢弃，释放 hold，否则控制器一直不跳过连接事件 */
+    if (queued && !notify_enabled) {
+        queued = 0;
+        lat_wake_release(demo_conn);
+    }
+
+    if (bursting && notify_enabled) {
+        /* 队列从空变为非空：停止跳过连接事件 */
+        if (!queued) {
+            lat_wake_hold(demo_conn);
+        }
+        queued = MIN(queued + DEMO_CHUNK, DEMO_QUEUE_MAX);
+    }
+    if (queued && notify_enabled) {
+        demo_flush();
+        /* 队列发空：稍后恢复从机延迟 */
+        if (!queued) {
+            lat_wake_release(demo_conn);
+        }
+    }
+
+    k_work_reschedule(&tick_work, K_MSEC(DEMO_TICK_MS));
+}
+
+/* ----------------对外接口---------------- */
+
+void traffic_demo_init(void)
+{
+    k_work_init_delayable(&tick_work, tick_work_handler);
+}
+
+void traffic_demo_start(struct bt_conn *conn)
+{
+    demo_conn = bt_conn_ref(conn);
+    queued = 0;
+    bursting = false;
+    phase_start_ms = k_uptime_get();
+    k_work_reschedule(&tick_work, K_MSEC(DEMO_TICK_MS));
+}
+
+void traffic_demo_stop(void)
+{
+    struct k_work_sync sync;
+
+    if (!demo_conn) {
+        return;
+    }
+
+    /* 等正在运行的 tick 结束，之后才能释放 demo_conn */
+    k_work_cancel_delayable_sync(&tick_work, &sync);
+    bt_conn_unref(demo_conn);
+    demo_conn = NULL;
+    notify_enabled = false;
+}
+
+uint32_t traffic_demo_depth(struct bt_conn *conn)
+{
+    return conn == demo_conn ? queued : 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * Module: Traffic Demo
+ * Description: 演示用流量源，给连接参数调节器 (conn_gov) 提供负载
+ *
+ * 对端打开通知后，按 "突发 DEMO_BURST_MS / 空闲 DEMO_IDLE_MS" 的节奏循环：
+ * 突发期间每 DEMO_TICK_MS 往软件队列里放 DEMO_CHUNK 字节，再尽量用通知发出去。
+ * 发不出去的字节留在队列里，队列深度通过 traffic_demo_depth() 交给调节器。
+ */
+
+#ifndef TRAFFIC_DEMO_H_
+#define TRAFFIC_DEMO_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief 初始化工作项 (在 bt_enable 之前调用一次) */
+void traffic_demo_init(void);
+
+/** @brief 连接建立后调用 */
+void traffic_demo_start(struct bt_conn *conn);
+
+/** @brief 连接断开后调用 */
+void traffic_demo_stop(void);
+
+/** @brief 当前队列中待发送的字节数 (conn_gov_depth_cb_t) */
+uint32_t traffic_demo_depth(struct bt_conn *conn);
+
+#endif /* TRAFFIC_DEMO_H_ */
@@ -1,10 +1,26 @@
 #include "my_service.h"
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(my_srv, LOG_LEVEL_INF);
 
 static uint8_t my_value[64] = {0x11, 0x22, 0x33, 0x44};
 
+// --- my_service 属性表下标 ---
+/*
+ * 与下面 BT_GATT_SERVICE_DEFINE 中的 [Index N] 注释一一对应。
+ * 发送通知时直接按下标取属性，不用每次按 UUID 遍历属性表。
+ */
+enum {
+    MY_SERVICE_ATTR_SVC,
+    MY_SERVICE_ATTR_RW_CHRC,
+    MY_SERVICE_ATTR_RW_VALUE,
+    MY_SERVICE_ATTR_NOTIFY_CHRC,
+    MY_SERVICE_ATTR_NOTIFY_VALUE,
+    MY_SERVICE_ATTR_NOTIFY_CCC,
+    MY_SERVICE_ATTR_COUNT,
+};
+
 static ssize_t on_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
                         const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
 {
@@ -65,38 +81,38 @@ BT_GATT_SERVICE_DEFINE(my_service,
     BT_GATT_CCC(on_cccd_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 );
 
+// 增删属性后忘了改上面的下标，编译时就会报错
+BUILD_ASSERT(ARRAY_SIZE(attr_my_service) == MY_SERVICE_ATTR_COUNT,
+             "my_service 属性数量与 MY_SERVICE_ATTR_* 下标不一致");
+
 // --- 初始化函数 ---
 int my_service_init(void)
 {
+    // 数量对但顺序不对的情况，在启动时检查一次 (不在发送路径上)
+    if (bt_uuid_cmp(my_service.attrs[MY_SERVICE_ATTR_NOTIFY_VALUE].uuid, MY_CHAR_NOTIFY_UUID)) {
+        LOG_ERR("Notify attribute index mismatch");
+        return -EINVAL;
+    }
     return 0;
 }
 // --- [Day 5 新增] 发送通知实现 ---
 // 临时替换 my_service.c 中的发送函数
 int my_service_send_button_notify(struct bt_conn *conn, uint8_t button_state)
 {
-    const struct bt_gatt_attr *target_attr = NULL;
-
-    for (size_t i = 0; i < my_service.attr_count; i++) {
-        const struct bt_gatt_attr *attr = &my_service.attrs[i];
-        
-        if (!bt_uuid_cmp(attr->uuid, MY_CHAR_NOTIFY_UUID)) {
-            target_attr = attr;
-            break;
-        }
-    }
-
-    if (!target_attr) {
-        LOG_ERR("Target Attribute NOT found!");
-        return -ENOENT;
-    }
-
-    const struct bt_gatt_attr *char_decl_attr = target_attr - 1;
+    // 属性位置在编译时就确定了，不再遍历属性表比较 UUID
+    const struct bt_gatt_attr *notify_attr = &my_service.attrs[MY_SERVICE_ATTR_NOTIFY_VALUE];
+    uint32_t start;
+    int err;
 
-    bool is_subscribed = bt_gatt_is_subscribed(conn, char_decl_attr, BT_GATT_CCC_NOTIFY);
+    bool is_subscribed = bt_gatt_is_subscribed(conn, notify_attr, BT_GATT_CCC_NOTIFY);
     
     if (is_subscribed) {
-        LOG_INF(">>> Subscribed! Sending data...");
-        return bt_gatt_notify(conn, char_decl_attr, &button_state, sizeof(button_state));
+        // 统计一次通知花费的 CPU 周期 (对比原来按 UUID 遍历的实现)
+        start = k_cycle_get_32();
+        err = bt_gatt_notify(conn, notify_attr, &button_state, sizeof(button_state));
+        LOG_INF(">>> Subscribed! Sent data (err %d, %u cycles)", err,
+                k_cycle_get_32() - start);
+        return err;
     } else {
         LOG_WRN(">>> Not subscribed (CCCD=0)");
         return -EACCES;
@@ -25,6 +25,15 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 #define BLE_MTU_MAX       247    // 期望的 MTU 大小 (需要在 prj.conf 中同时也配置)
 #define WORK_RETRY_DELAY  K_MSEC(5) // 如果 BLE 缓冲区满，多久后重试
 
+/*
+ * 有线侧硬件流控 (RTS/CTS，见 overlay 中的 hw-flow-control)
+ * RingBuffer 超过高水位时停止读 UART FIFO，UARTE 硬件随即撤销 RTS，PC 停止发送；
+ * BLE 发送任务把数据消耗到低水位以下后恢复接收。
+ * 高水位之上要留出一次 uart_fifo_read 的余量 (recv_buf 大小 64 字节)。
+ */
+#define UART_RX_HIGH_WATERMARK  (UART_BUF_SIZE - 128)
+#define UART_RX_LOW_WATERMARK   (UART_BUF_SIZE / 2)
+
 /* ----------------硬件定义---------------- */
 /* 获取 Overlay 中定义的别名 */
 static const struct gpio_dt_spec led_conn = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
@@ -45,6 +54,11 @@ static struct k_work_delayable ble_tx_work;
 static struct bt_conn *current_conn;
 static uint16_t current_mtu = 23; // 默认 MTU，连接后会更新
 
+/* 到达高水位后 UART 接收被暂停 (RTS 撤销) */
+static atomic_t rx_paused;
+/* 丢弃字节数：开启硬件流控后应始终为 0 */
+static uint32_t rx_dropped;
+
 /* ----------------函数声明---------------- */
 static void uart_cb(const struct device *dev, void *user_data);
 static void ble_tx_work_handler(struct k_work *work);
@@ -100,7 +114,15 @@ static void uart_cb(const struct device *dev, void *user_data)
             int written = ring_buf_put(&uart_ring_buf, recv_buf, recv_len);
             
             if (written < recv_len) {
-                LOG_WRN("RingBuffer Full! Dropped %d bytes", recv_len - written);
+                rx_dropped += recv_len - written;
+                LOG_WRN("RingBuffer Full! Dropped %d bytes (total %u)",
+                        recv_len - written, rx_dropped);
+            }
+
+            /* 超过高水位：停止读 FIFO，UARTE 内部 FIFO 将满时硬件撤销 RTS */
+            if (ring_buf_size_get(&uart_ring_buf) >= UART_RX_HIGH_WATERMARK) {
+                uart_irq_rx_disable(dev);
+                atomic_set(&rx_paused, 1);
             }
 
             /* 触发 System Work Queue 进行 BLE 发送处理 */
@@ -118,6 +140,15 @@ static void uart_cb(const struct device *dev, void *user_data)
  *  BLE 处理逻辑 (消费者)
  * ============================================================ */
 
+/* 消费者降到低水位以下：恢复 UART 接收，RTS 重新有效 */
+static void uart_rx_check_resume(void)
+{
+    if (ring_buf_size_get(&uart_ring_buf) <= UART_RX_LOW_WATERMARK &&
+        atomic_cas(&rx_paused, 1, 0)) {
+        uart_irq_rx_enable(uart_dev);
+    }
+}
+
 /* 
  * 核心任务：从 RingBuffer 取数据发给 BLE
  * 包含了流控逻辑：如果 BLE 返回忙，则不消耗 Buffer，稍后重试。
@@ -131,6 +162,7 @@ static void ble_tx_work_handler(struct k_work *work)
     if (!current_conn) {
         // 如果没有连接，丢弃缓冲区数据，防止溢出
         ring_buf_reset(&uart_ring_buf);
+        uart_rx_check_resume();
         return;
     }
 
@@ -177,6 +209,8 @@ static void ble_tx_work_handler(struct k_work *work)
             ring_buf_get_finish(&uart_ring_buf, len);
         }
     }
+
+    uart_rx_check_resume();
 }
 
 /* NUS 接收到手机数据回调 */
@@ -0,0 +1,97 @@
+#!/usr/bin/env bash
+#
+# Day 7 PHY 自动选择验证 (BabbleSim 衰减场景)
+#
+# 用法: ./run_phy_fade.sh [auto|fixed] [仿真秒数]
+#   auto:  外设开启 CONFIG_APP_BRIDGE_PHY_AUTO (默认)
+#   fixed: 外设固定 2M PHY，作为对照 (预期在深度衰减时监督超时断开)
+#
+# 外设跑发生器 (全速通知)，两者之间的衰减随时间变化 (发射功率 0 dBm，RSSI ≈ -衰减)：
+#   0  - 10 s   60 dB
+#   10 - 40 s   60 → 100 dB 线性增加
+#   40 - 50 s   100 dB
+#   50 - 80 s   100 → 60 dB 线性减小
+#   80 s -      60 dB
+# 使用 ext_2G4_channel_multiatt 信道模型，设备对之间的衰减取自随时间变化的文件
+# (每行 "<时间 us> <衰减 dB>"，中间线性插值)。
+#
+# auto 模式通过条件: 有降级、最后回到 2M、没有断开过。
+#
+# 依赖环境变量同 run_throughput.sh: ZEPHYR_BASE, BSIM_OUT_PATH, BSIM_COMPONENTS_PATH
+#
+set -eu
+
+MODE=${1:-auto}
+SIM_SEC=${2:-90}
+
+APP_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-$APP_DIR/build_bsim}
+SIM_ID=day7_phy_fade_${MODE}
+PERIPH_LOG=$BUILD_DIR/peripheral_fade.log
+CENTRAL_LOG=$BUILD_DIR/central_fade.log
+
+PERIPH_ARGS="-DCONFIG_APP_NUS_TEST=y -DCONFIG_APP_NUS_TEST_GENERATOR=y"
+case "$MODE" in
+auto)
+    PERIPH_ARGS="$PERIPH_ARGS -DCONFIG_APP_BRIDGE_PHY_AUTO=y"
+    ;;
+fixed)
+    ;;
+*)
+    echo "Unknown mode: $MODE (expected auto|fixed)" >&2
+    exit 1
+    ;;
+esac
+
+# 1. 编译外设和测试主机
+west build -b nrf52_bsim -p always -d "$BUILD_DIR/peripheral" "$APP_DIR" -- $PERIPH_ARGS
+west build -b nrf52_bsim -p always -d "$BUILD_DIR/central" "$APP_DIR/central"
+
+# 2. 生成衰减文件
+mkdir -p "$BUILD_DIR"
+FADE_FILE=$BUILD_DIR/fade.txt
+ATT_FILE=$BUILD_DIR/fade_matrix.txt
+cat > "$FADE_FILE" <<EOF
+0 60
+10000000 60
+40000000 100
+50000000 100
+80000000 60
+EOF
+cat > "$ATT_FILE" <<EOF
+0 1 : "$FADE_FILE"
+1 0 : "$FADE_FILE"
+EOF
+
+# 3. 启动两个设备和 2.4G 物理层仿真
+rm -f "$PERIPH_LOG" "$CENTRAL_LOG"
+cd "$BSIM_OUT_PATH/bin"
+"$BUILD_DIR/peripheral/zephyr/zephyr.exe" -s="$SIM_ID" -d=0 -rs=1 > "$PERIPH_LOG" 2>&1 &
+"$BUILD_DIR/central/zephyr/zephyr.exe" -s="$SIM_ID" -d=1 -rs=2 > "$CENTRAL_LOG" 2>&1 &
+./bs_2G4_phy_v1 -s="$SIM_ID" -D=2 -sim_length=$((SIM_SEC * 1000000)) \
+    -channel=multiatt -argschannel -file="$ATT_FILE" > /dev/null
+wait
+
+# 4. 结果
+echo "==== PHY fade ($MODE) ===="
+grep "\[PHY" "$PERIPH_LOG" || true
+grep "NUS TEST" "$PERIPH_LOG" | tail -n 1 || true
+# 发生器在连接断开时打印 NUS TEST TOTAL (仿真结束时连接还在，不会打印)
+DISCONNECTS=$(grep -c "NUS TEST TOTAL" "$PERIPH_LOG" || true)
+echo "disconnects: $DISCONNECTS"
+
+if [ "$MODE" = auto ]; then
+    if ! grep -q "\[PHY .*-> 1M" "$PERIPH_LOG"; then
+        echo "FAIL: PHY never stepped down" >&2
+        exit 1
+    fi
+    if [ "$(grep "\[PHY .*->" "$PERIPH_LOG" | tail -n 1 | sed 's/.*-> \([^ ]*\).*/\1/')" != 2M ]; then
+        echo "FAIL: PHY did not recover to 2M" >&2
+        exit 1
+    fi
+    if [ "$DISCONNECTS" -ne 0 ]; then
+        echo "FAIL: link dropped during the fade" >&2
+        exit 1
+    fi
+    echo "PASS"
+fi
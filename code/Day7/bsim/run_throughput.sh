@@ -0,0 +1,109 @@
+#!/usr/bin/env bash
+#
+# Day 7 NUS 吞吐量测试 (BabbleSim, nrf52_bsim)
+#
+# 用法: ./run_throughput.sh [generator|sink] [仿真秒数] [gatt|eatt|l2cap] [raw|lz|mux]
+#   generator: 外设全速发通知，测试主机接收并校验
+#   sink:      测试主机全速写入，外设接收并校验
+#   gatt:      数据走 NUS 通知 / Write Without Response (默认)
+#   eatt:      同 gatt，但数据通知走 EATT 信道，读探测和流控留在传统 ATT 信道
+#   l2cap:     数据走 L2CAP CoC 透传通道，用于和 gatt 对比有效吞吐量
+#   lz:        外设压缩上行数据，测试主机解压后校验 (仅 generator 方向)
+#   mux:       收发都使用多通道帧，测试主机额外报告控制通道 PING 的往返延迟
+#
+# 依赖环境变量 (参考 Zephyr 文档 "BabbleSim" 一节):
+#   ZEPHYR_BASE, BSIM_OUT_PATH, BSIM_COMPONENTS_PATH
+# 可选: PERIPH_EXTRA_ARGS 追加外设的编译参数，例如
+#   PERIPH_EXTRA_ARGS="-DCONFIG_APP_NUS_TEST_WQ_LOAD_US=2000 -DCONFIG_APP_BRIDGE_TX_THREAD=n"
+# 可选: CENTRAL_EXTRA_ARGS 追加测试主机的编译参数
+# 可选: READ_PROBE_MS gatt/eatt 下测试主机读 Flow 特征值的间隔 (混合流量，默认 100，0 关闭)
+#
+set -eu
+
+MODE=${1:-generator}
+SIM_SEC=${2:-20}
+TRANSPORT=${3:-gatt}
+CODEC=${4:-raw}
+
+APP_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-$APP_DIR/build_bsim}
+SIM_ID=day7_nus_${MODE}_${TRANSPORT}_${CODEC}
+
+case "$MODE" in
+generator)
+    PERIPH_ARGS="-DCONFIG_APP_NUS_TEST=y -DCONFIG_APP_NUS_TEST_GENERATOR=y"
+    CENTRAL_ARGS=""
+    ;;
+sink)
+    PERIPH_ARGS="-DCONFIG_APP_NUS_TEST=y -DCONFIG_APP_NUS_TEST_SINK=y"
+    CENTRAL_ARGS="-DCONFIG_APP_CENTRAL_WRITE=y"
+    ;;
+*)
+    echo "Unknown mode: $MODE (expected generator|sink)" >&2
+    exit 1
+    ;;
+esac
+
+READ_PROBE_MS=${READ_PROBE_MS:-100}
+
+case "$TRANSPORT" in
+gatt)
+    CENTRAL_ARGS="$CENTRAL_ARGS -DCONFIG_APP_CENTRAL_READ_PROBE_MS=$READ_PROBE_MS"
+    ;;
+eatt)
+    # 写命令不能指定信道，EATT 和传统信道上的写可能在外设乱序
+    if [ "$MODE" = sink ]; then
+        echo "eatt transport only supports generator mode" >&2
+        exit 1
+    fi
+    PERIPH_ARGS="$PERIPH_ARGS -DCONFIG_APP_BRIDGE_EATT=y"
+    CENTRAL_ARGS="$CENTRAL_ARGS -DCONFIG_APP_CENTRAL_EATT=y -DCONFIG_APP_CENTRAL_READ_PROBE_MS=$READ_PROBE_MS"
+    ;;
+l2cap)
+    CENTRAL_ARGS="$CENTRAL_ARGS -DCONFIG_APP_CENTRAL_L2CAP=y"
+    ;;
+*)
+    echo "Unknown transport: $TRANSPORT (expected gatt|eatt|l2cap)" >&2
+    exit 1
+    ;;
+esac
+
+case "$CODEC" in
+raw)
+    ;;
+lz)
+    PERIPH_ARGS="$PERIPH_ARGS -DCONFIG_APP_BRIDGE_COMPRESS=y"
+    CENTRAL_ARGS="$CENTRAL_ARGS -DCONFIG_APP_CENTRAL_DECOMPRESS=y"
+    ;;
+mux)
+    PERIPH_ARGS="$PERIPH_ARGS -DCONFIG_APP_BRIDGE_MUX=y"
+    CENTRAL_ARGS="$CENTRAL_ARGS -DCONFIG_APP_CENTRAL_MUX=y"
+    ;;
+*)
+    echo "Unknown codec: $CODEC (expected raw|lz|mux)" >&2
+    exit 1
+    ;;
+esac
+
+PERIPH_ARGS="$PERIPH_ARGS ${PERIPH_EXTRA_ARGS:-}"
+CENTRAL_ARGS="$CENTRAL_ARGS ${CENTRAL_EXTRA_ARGS:-}"
+
+# 1. 编译外设和测试主机
+west build -b nrf52_bsim -p always -d "$BUILD_DIR/peripheral" "$APP_DIR" -- $PERIPH_ARGS
+west build -b nrf52_bsim -p always -d "$BUILD_DIR/central" "$APP_DIR/central" -- $CENTRAL_ARGS
+
+# 2. 启动两个设备和 2.4G 物理层仿真 (仿真时间单位 us)
+cd "$BSIM_OUT_PATH/bin"
+"$BUILD_DIR/peripheral/zephyr/zephyr.exe" -s="$SIM_ID" -d=0 -rs=1 > "$BUILD_DIR/peripheral.log" 2>&1 &
+"$BUILD_DIR/central/zephyr/zephyr.exe" -s="$SIM_ID" -d=1 -rs=2 > "$BUILD_DIR/central.log" 2>&1 &
+./bs_2G4_phy_v1 -s="$SIM_ID" -D=2 -sim_length=$((SIM_SEC * 1000000)) > /dev/null
+wait
+
+# 3. 输出最后几次报告
+echo "==== $MODE over $TRANSPORT ($CODEC) ===="
+echo "---- peripheral ----"
+grep "NUS TEST" "$BUILD_DIR/peripheral.log" | tail -n 3
+grep "TX pump" "$BUILD_DIR/peripheral.log" | tail -n 1 || true
+grep "\[LINK" "$BUILD_DIR/peripheral.log" | tail -n 1 || true
+echo "---- central ----"
+grep "CENTRAL" "$BUILD_DIR/central.log" | tail -n 4
@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+#
+# Day 7 吞吐量参数扫描 (BabbleSim, nrf52_bsim)
+#
+# 用法: ./sweep.sh [输出 CSV，默认 $BUILD_DIR/sweep.csv]
+#
+# 对每个参数组合，用 run_throughput.sh 编译外设 (发生器测试 + 延迟直方图) 和测试主机，
+# 链路就绪后跑 RUN_SEC 秒，测试主机打印汇总并断开，外设随即打印它那一侧的汇总。
+# 每个组合在 CSV 中占一行：
+#   interval,mtu,data_len,phy,ring,goodput_kbps,lat_avg_us,lat_max_us,cpu_pct,seq_err
+#   goodput_kbps  测试主机收到并校验的有效负载速率 ([CENTRAL TOTAL])
+#   lat_*_us      外设 "Latency total" (生成数据 → 发送完成)
+#   cpu_pct       外设非空闲 CPU 占比 (NUS TEST TOTAL)；BabbleSim 中代码执行不占仿真时间，
+#                 这一列只有在真实硬件上才有意义
+#   没有取到的字段留空 (例如链路没有建立)。
+#
+# 扫描范围用环境变量覆盖 (空格分隔):
+#   INTERVALS  连接间隔 (1.25 ms 单位)  默认 "6 24 48"
+#   MTUS       ATT MTU (CONFIG_BT_L2CAP_TX_MTU)            默认 "23 247"
+#   DATA_LENS  LL 最大数据长度 (CONFIG_BT_CTLR_DATA_LENGTH_MAX) 默认 "27 251"
+#   PHYS       1M / 2M                   默认 "1M 2M"
+#   RINGS      uart_ring_buf 大小 (字节) 默认 "2048 8192"
+#   RUN_SEC    每个组合的测试时长 (秒)   默认 10
+#
+set -eu
+
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+APP_DIR=$(cd "$SCRIPT_DIR/.." && pwd)
+export BUILD_DIR=${BUILD_DIR:-$APP_DIR/build_bsim}
+CSV=${1:-$BUILD_DIR/sweep.csv}
+
+INTERVALS=${INTERVALS:-"6 24 48"}
+MTUS=${MTUS:-"23 247"}
+DATA_LENS=${DATA_LENS:-"27 251"}
+PHYS=${PHYS:-"1M 2M"}
+RINGS=${RINGS:-"2048 8192"}
+RUN_SEC=${RUN_SEC:-10}
+
+# 连接建立 + 链路优化 (最坏情况下某一步超时重试) 留出余量
+SIM_SEC=$((RUN_SEC + 10))
+
+mkdir -p "$BUILD_DIR" "$(dirname "$CSV")"
+echo "interval,mtu,data_len,phy,ring,goodput_kbps,lat_avg_us,lat_max_us,cpu_pct,seq_err" > "$CSV"
+
+# 从日志中取 "<key> <数字>" 形式的字段 (只看最后一次出现)
+field() {
+    local pattern=$1 key=$2 log=$3
+
+    grep "$pattern" "$log" 2>/dev/null | tail -n 1 |
+        sed -n "s/.*$key \([0-9]*\).*/\1/p"
+}
+
+for interval in $INTERVALS; do
+for mtu in $MTUS; do
+for data_len in $DATA_LENS; do
+for phy in $PHYS; do
+for ring in $RINGS; do
+    case "$phy" in
+    1M) phy_2m=n ;;
+    2M) phy_2m=y ;;
+    *)
+        echo "Unknown PHY: $phy (expected 1M|2M)" >&2
+        exit 1
+        ;;
+    esac
+
+    echo "==== interval $interval, mtu $mtu, data_len $data_len, phy $phy, ring $ring ===="
+
+    LINK_ARGS="-DCONFIG_BT_L2CAP_TX_MTU=$mtu -DCONFIG_BT_CTLR_DATA_LENGTH_MAX=$data_len"
+    export PERIPH_EXTRA_ARGS="$LINK_ARGS -DCONFIG_APP_BRIDGE_LATENCY=y \
+        -DCONFIG_APP_BRIDGE_CONN_INTERVAL=$interval -DCONFIG_APP_BRIDGE_PHY_2M=$phy_2m \
+        -DCONFIG_APP_BRIDGE_UART_BUF_SIZE=$ring"
+    export CENTRAL_EXTRA_ARGS="$LINK_ARGS -DCONFIG_APP_CENTRAL_CONN_INTERVAL=$interval \
+        -DCONFIG_APP_CENTRAL_PHY_2M=$phy_2m -DCONFIG_APP_CENTRAL_RUN_MS=$((RUN_SEC * 1000))"
+    export READ_PROBE_MS=0
+
+    P="$BUILD_DIR/peripheral.log"
+    C="$BUILD_DIR/central.log"
+    rm -f "$P" "$C"
+
+    # 某个组合编译或运行失败时继续下一个，CSV 中该行结果为空
+    "$SCRIPT_DIR/run_throughput.sh" generator "$SIM_SEC" gatt raw || true
+
+    echo "$interval,$mtu,$data_len,$phy,$ring,$(field 'CENTRAL TOTAL' rx "$C"),$(field 'Latency total' avg "$P"),$(field 'Latency total' max "$P"),$(field 'NUS TEST TOTAL' cpu "$P"),$(field 'CENTRAL TOTAL' seq_err "$C")" >> "$CSV"
+done
+done
+done
+done
+done
+
+echo "==== results: $CSV ===="
+cat "$CSV"
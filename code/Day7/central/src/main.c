@@ -0,0 +1,752 @@
+/*
+ * Day 7 Test Central: NUS 吞吐量测试主机
+ * Environment: nrf52_bsim (BabbleSim) / nRF52 DK, NCS v2.7.0
+ *
+ * 作为外设 (code/Day7, CONFIG_APP_NUS_TEST=y) 的对端：
+ * 1. 扫描带 NUS Service UUID 的广播并连接
+ * 2. MTU 交换 + DLE + 2M PHY，然后发现 NUS 的 TX/RX 特征值并订阅通知
+ * 3. 校验外设发来的计数流 (发生器测试)，或者全速写入计数流 (接收端测试)
+ * 4. 周期性打印吞吐量和序号错误
+ *
+ * CONFIG_APP_CENTRAL_L2CAP=y 时不使用 NUS，而是在 MTU 交换后打开外设的
+ * L2CAP 透传通道 (L2CAP_BRIDGE_PSM)，用同样的计数流对比两种传输方式的有效吞吐量。
+ *
+ * CONFIG_APP_CENTRAL_MUX=y 时计数流走多通道帧的控制台通道，并周期性地在控制通道
+ * 发送 PING，测量控制消息在满负荷透传时的往返延迟。
+ *
+ * CONFIG_APP_CENTRAL_READ_PROBE_MS > 0 时周期性读外设的 Flow 特征值，测量满负荷通知期间
+ * 读请求的往返延迟 (混合流量)；配合 CONFIG_APP_CENTRAL_EATT 对比 EATT 和传统 ATT 信道。
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/att.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include "nus.h"
+#include "l2cap_bridge.h"
+#include "lz_codec.h"
+#include "mux.h"
+
+LOG_MODULE_REGISTER(central, LOG_LEVEL_INF);
+
+/* ----------------全局变量---------------- */
+static struct bt_conn *default_conn;
+
+/* 发现到的 NUS 特征值句柄 */
+static uint16_t nus_tx_handle;
+static uint16_t nus_rx_handle;
+static uint16_t nus_flow_handle;
+
+static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+
+/* 写入窗口：和外设的通知窗口一样，按 TX Buffer 数量限制在途的写命令 */
+static K_SEM_DEFINE(tx_window, MY_NUS_TX_WINDOW, MY_NUS_TX_WINDOW);
+static K_SEM_DEFINE(link_ready, 0, 1);
+
+/* 统计 */
+static atomic_t stat_rx_bytes;
+static atomic_t stat_tx_bytes;
+static atomic_t stat_seq_err;
+static uint8_t rx_next;
+static bool rx_synced;
+static uint8_t tx_next;
+
+static struct k_work_delayable report_work;
+
+/* 本次测试开始 (链路就绪) 时的时间和计数，用于最后的汇总 */
+static int64_t run_start_ms;
+static uint32_t run_start_rx;
+static uint32_t run_start_tx;
+#if CONFIG_APP_CENTRAL_RUN_MS > 0
+static struct k_work_delayable run_end_work;
+static bool run_done;
+#endif
+
+#if defined(CONFIG_APP_CENTRAL_MUX)
+/* 控制通道往返延迟 (PING 里带发送时刻，外设原样回 PONG) */
+static uint32_t ping_rtt_last;
+static uint32_t ping_rtt_max;
+static uint32_t ping_lost;
+static bool ping_outstanding;
+#endif
+
+#if defined(CONFIG_APP_CENTRAL_READ_PROBE_MS) && CONFIG_APP_CENTRAL_READ_PROBE_MS > 0
+#define READ_PROBE_ENABLED 1
+/* 读探测：统计一个报告周期内读请求的平均往返延迟和历史最大值 */
+static struct bt_gatt_read_params probe_params;
+static struct k_work_delayable probe_work;
+static uint32_t probe_start;
+static uint32_t probe_count;
+static uint32_t probe_sum_ms;
+static uint32_t probe_max_ms;
+static bool probe_busy;
+#endif
+
+#if defined(CONFIG_APP_CENTRAL_DECOMPRESS)
+static struct lz_decoder lz_dec;
+static uint8_t lz_out[LZ_CHUNK_MAX];
+#endif
+
+#if defined(CONFIG_APP_CENTRAL_L2CAP)
+/*
+ * L2CAP 透传通道
+ * 接收侧给足初始信用 (4 个 SDU)，否则外设每发完一个 SDU 都要等一次信用往返
+ */
+#define L2CAP_RX_INIT_CREDITS  (4 * DIV_ROUND_UP(L2CAP_BRIDGE_SDU_LEN + 2, BT_L2CAP_RX_MTU))
+
+NET_BUF_POOL_FIXED_DEFINE(l2cap_tx_pool, 3, BT_L2CAP_SDU_BUF_SIZE(L2CAP_BRIDGE_SDU_LEN),
+                          CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+NET_BUF_POOL_FIXED_DEFINE(l2cap_rx_pool, 2, BT_L2CAP_SDU_BUF_SIZE(L2CAP_BRIDGE_SDU_LEN),
+                          8, NULL);
+
+static struct bt_l2cap_le_chan l2cap_chan;
+static atomic_t l2cap_ready;
+#endif
+
+static void start_scan(void);
+static bool link_writable(void);
+static int link_write(const uint8_t *data, uint16_t len);
+
+#if defined(CONFIG_APP_CENTRAL_MUX)
+/* 在控制通道发一个 PING (写入窗口被计数流占满时本次跳过) */
+static void ping_send(void)
+{
+    uint8_t frame[1 + sizeof(uint32_t) + MUX_OVERHEAD];
+    uint8_t *msg = frame + MUX_HDR_LEN;
+    uint32_t len;
+
+    if (!link_writable()) {
+        return;
+    }
+    if (ping_outstanding) {
+        ping_lost++;
+        ping_outstanding = false;
+    }
+    if (k_sem_take(&tx_window, K_NO_WAIT)) {
+        return;
+    }
+
+    msg[0] = MUX_CTRL_PING;
+    sys_put_le32(k_uptime_get_32(), msg + 1);
+    len = mux_frame_put(frame, MUX_CH_CONTROL, msg, 1 + sizeof(uint32_t));
+
+    if (link_write(frame, len)) {
+        k_sem_give(&tx_window);
+        return;
+    }
+    ping_outstanding = true;
+}
+#endif
+
+#if defined(READ_PROBE_ENABLED)
+static uint8_t probe_read_func(struct bt_conn *conn, uint8_t err,
+                               struct bt_gatt_read_params *params,
+                               const void *data, uint16_t length)
+{
+    uint32_t rtt = k_uptime_get_32() - probe_start;
+
+    if (!probe_busy) {
+        return BT_GATT_ITER_STOP;
+    }
+    probe_busy = false;
+
+    if (err) {
+        LOG_WRN("Probe read failed (err 0x%02x)", err);
+        return BT_GATT_ITER_STOP;
+    }
+
+    probe_count++;
+    probe_sum_ms += rtt;
+    probe_max_ms = MAX(probe_max_ms, rtt);
+    return BT_GATT_ITER_STOP;
+}
+
+/* 当前连接上的 EATT 信道数量 (0 表示所有流量都在传统信道上) */
+static uint32_t eatt_bearers(void)
+{
+#if defined(CONFIG_APP_CENTRAL_EATT)
+    return default_conn ? (uint32_t)bt_eatt_count(default_conn) : 0U;
+#else
+    return 0U;
+#endif
+}
+
+/* 周期性读 Flow 特征值 (上一次还没回来就跳过) */
+static void probe_work_handler(struct k_work *work)
+{
+    if (default_conn && nus_flow_handle && !probe_busy) {
+        probe_params.func = probe_read_func;
+        probe_params.handle_count = 1;
+        probe_params.single.handle = nus_flow_handle;
+        probe_params.single.offset = 0;
+#if defined(CONFIG_APP_CENTRAL_EATT)
+        /* 控制类流量固定走传统信道，外设的数据通知在 EATT 信道上 */
+        probe_params.chan_opt = BT_ATT_CHAN_OPT_UNENHANCED_ONLY;
+#endif
+        probe_start = k_uptime_get_32();
+        probe_busy = true;
+        if (bt_gatt_read(default_conn, &probe_params)) {
+            probe_busy = false;
+        }
+    }
+
+    k_work_reschedule(&probe_work, K_MSEC(CONFIG_APP_CENTRAL_READ_PROBE_MS));
+}
+#endif
+
+/* ----------------报告---------------- */
+
+static void report_work_handler(struct k_work *work)
+{
+    static uint32_t last_rx;
+    static uint32_t last_tx;
+    uint32_t rx = atomic_get(&stat_rx_bytes);
+    uint32_t tx = atomic_get(&stat_tx_bytes);
+
+    printk("[CENTRAL] rx %u kbps, tx %u kbps, seq_err %d\n",
+           (uint32_t)((uint64_t)(rx - last_rx) * 8 / CONFIG_APP_CENTRAL_REPORT_INTERVAL_MS),
+           (uint32_t)((uint64_t)(tx - last_tx) * 8 / CONFIG_APP_CENTRAL_REPORT_INTERVAL_MS),
+           (int)atomic_get(&stat_seq_err));
+
+#if defined(CONFIG_APP_CENTRAL_MUX)
+    printk("[CENTRAL] ping rtt %u ms, max %u ms, lost %u\n",
+           ping_rtt_last, ping_rtt_max, ping_lost);
+    ping_send();
+#endif
+
+#if defined(READ_PROBE_ENABLED)
+    printk("[CENTRAL] read rtt avg %u ms, max %u ms (%u reads), eatt bearers %u\n",
+           probe_count ? probe_sum_ms / probe_count : 0, probe_max_ms, probe_count,
+           eatt_bearers());
+    probe_count = 0;
+    probe_sum_ms = 0;
+#endif
+
+    last_rx = rx;
+    last_tx = tx;
+    k_work_reschedule(&report_work, K_MSEC(CONFIG_APP_CENTRAL_REPORT_INTERVAL_MS));
+}
+
+/* 测试时间到：打印整次汇总，断开连接 (外设随即打印它那一侧的汇总) */
+#if CONFIG_APP_CENTRAL_RUN_MS > 0
+static void run_end_work_handler(struct k_work *work)
+{
+    int64_t elapsed_ms = MAX(k_uptime_get() - run_start_ms, 1);
+
+    printk("[CENTRAL TOTAL] %lld ms: rx %u kbps, tx %u kbps, seq_err %d\n", elapsed_ms,
+           (uint32_t)((uint64_t)(atomic_get(&stat_rx_bytes) - run_start_rx) * 8 / elapsed_ms),
+           (uint32_t)((uint64_t)(atomic_get(&stat_tx_bytes) - run_start_tx) * 8 / elapsed_ms),
+           (int)atomic_get(&stat_seq_err));
+
+    run_done = true;
+    if (default_conn) {
+        bt_conn_disconnect(default_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    }
+}
+#endif
+
+/* 链路就绪 (已订阅 NUS 通知或打开了 L2CAP 通道)：开始报告，唤醒写线程 */
+static void link_up(void)
+{
+    run_start_ms = k_uptime_get();
+    run_start_rx = atomic_get(&stat_rx_bytes);
+    run_start_tx = atomic_get(&stat_tx_bytes);
+
+    k_work_reschedule(&report_work, K_MSEC(CONFIG_APP_CENTRAL_REPORT_INTERVAL_MS));
+#if CONFIG_APP_CENTRAL_RUN_MS > 0
+    k_work_reschedule(&run_end_work, K_MSEC(CONFIG_APP_CENTRAL_RUN_MS));
+#endif
+    k_sem_give(&link_ready);
+}
+
+/* 校验外设发来的计数流是否连续 */
+static void rx_verify(const uint8_t *buf, uint16_t length)
+{
+    if (!rx_synced && length) {
+        rx_next = buf[0];
+        rx_synced = true;
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        if (buf[i] != rx_next) {
+            atomic_inc(&stat_seq_err);
+        }
+        rx_next = buf[i] + 1;
+    }
+    atomic_add(&stat_rx_bytes, length);
+}
+
+#if defined(CONFIG_APP_CENTRAL_MUX)
+/* 外设发来的一个帧：控制台通道是计数流，控制通道是 PONG */
+static void mux_received(struct bt_conn *conn, uint8_t ch, const uint8_t *data, uint16_t len)
+{
+    if (ch == MUX_CH_CONSOLE) {
+        rx_verify(data, len);
+    } else if (ch == MUX_CH_CONTROL && len == 1 + sizeof(uint32_t) &&
+               data[0] == MUX_CTRL_PONG) {
+        ping_rtt_last = k_uptime_get_32() - sys_get_le32(data + 1);
+        ping_rtt_max = MAX(ping_rtt_max, ping_rtt_last);
+        ping_outstanding = false;
+    }
+}
+#endif
+
+/* 收到一包数据 (压缩模式下先解压，多通道模式下先拆帧) */
+static void rx_deliver(const uint8_t *data, uint16_t length)
+{
+#if defined(CONFIG_APP_CENTRAL_MUX)
+    if (mux_check(data, length, NULL)) {
+        LOG_ERR("Bad mux frame");
+        atomic_inc(&stat_seq_err);
+        return;
+    }
+    mux_dispatch(default_conn, data, length, mux_received);
+#elif defined(CONFIG_APP_CENTRAL_DECOMPRESS)
+    int n = lz_decode_frame(&lz_dec, data, length, lz_out, sizeof(lz_out));
+
+    if (n < 0) {
+        LOG_ERR("Bad LZ frame (err %d)", n);
+        atomic_inc(&stat_seq_err);
+        return;
+    }
+    rx_verify(lz_out, n);
+#else
+    rx_verify(data, length);
+#endif
+}
+
+/* ----------------GATT Client---------------- */
+
+/* 收到外设通知 */
+static uint8_t notify_func(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                           const void *data, uint16_t length)
+{
+    if (!data) {
+        LOG_INF("Unsubscribed");
+        params->value_handle = 0U;
+        return BT_GATT_ITER_STOP;
+    }
+
+    rx_deliver(data, length);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static void subscribe_nus_tx(struct bt_conn *conn)
+{
+    int err;
+
+    subscribe_params.notify = notify_func;
+    subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    subscribe_params.value_handle = nus_tx_handle;
+    /* my_nus_svc 中 CCC 紧跟在 TX 特征值之后 */
+    subscribe_params.ccc_handle = nus_tx_handle + 1;
+
+    err = bt_gatt_subscribe(conn, &subscribe_params);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Subscribe failed (err %d)", err);
+        return;
+    }
+
+    LOG_INF("Subscribed to NUS TX");
+#if defined(READ_PROBE_ENABLED)
+    k_work_reschedule(&probe_work, K_MSEC(CONFIG_APP_CENTRAL_READ_PROBE_MS));
+#endif
+    link_up();
+}
+
+/* 遍历所有特征值，记录 NUS TX/RX 的 Value Handle */
+static uint8_t discover_func(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             struct bt_gatt_discover_params *params)
+{
+    const struct bt_gatt_chrc *chrc;
+
+    if (!attr) {
+        if (!nus_tx_handle || !nus_rx_handle) {
+            LOG_ERR("NUS characteristics not found");
+            return BT_GATT_ITER_STOP;
+        }
+        subscribe_nus_tx(conn);
+        return BT_GATT_ITER_STOP;
+    }
+
+    chrc = attr->user_data;
+    if (!bt_uuid_cmp(chrc->uuid, BT_UUID_MY_NUS_TX)) {
+        nus_tx_handle = chrc->value_handle;
+    } else if (!bt_uuid_cmp(chrc->uuid, BT_UUID_MY_NUS_RX)) {
+        nus_rx_handle = chrc->value_handle;
+    } else if (!bt_uuid_cmp(chrc->uuid, BT_UUID_MY_NUS_FLOW)) {
+        nus_flow_handle = chrc->value_handle;
+    }
+
+    return BT_GATT_ITER_CONTINUE;
+}
+
+/* ----------------L2CAP 透传通道---------------- */
+
+#if defined(CONFIG_APP_CENTRAL_L2CAP)
+
+static struct net_buf *l2cap_alloc_buf(struct bt_l2cap_chan *chan)
+{
+    return net_buf_alloc(&l2cap_rx_pool, K_FOREVER);
+}
+
+static void l2cap_connected(struct bt_l2cap_chan *chan)
+{
+    LOG_INF("L2CAP connected: tx mtu %u mps %u, rx mtu %u mps %u",
+            l2cap_chan.tx.mtu, l2cap_chan.tx.mps, l2cap_chan.rx.mtu, l2cap_chan.rx.mps);
+    atomic_set(&l2cap_ready, 1);
+    link_up();
+}
+
+static void l2cap_disconnected(struct bt_l2cap_chan *chan)
+{
+    LOG_INF("L2CAP disconnected");
+    atomic_clear(&l2cap_ready);
+}
+
+static int l2cap_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+    rx_deliver(buf->data, buf->len);
+    return 0;
+}
+
+/* 一个 SDU 发送完成，窗口腾出一个空位 */
+static void l2cap_sent(struct bt_l2cap_chan *chan)
+{
+    k_sem_give(&tx_window);
+}
+
+static const struct bt_l2cap_chan_ops l2cap_ops = {
+    .alloc_buf = l2cap_alloc_buf,
+    .connected = l2cap_connected,
+    .disconnected = l2cap_disconnected,
+    .recv = l2cap_recv,
+    .sent = l2cap_sent,
+};
+
+static void l2cap_open(struct bt_conn *conn)
+{
+    int err;
+
+    memset(&l2cap_chan, 0, sizeof(l2cap_chan));
+    l2cap_chan.chan.ops = &l2cap_ops;
+    l2cap_chan.rx.mtu = L2CAP_BRIDGE_SDU_LEN;
+    l2cap_chan.rx.init_credits = L2CAP_RX_INIT_CREDITS;
+
+    err = bt_l2cap_chan_connect(conn, &l2cap_chan.chan, L2CAP_BRIDGE_PSM);
+    if (err) {
+        LOG_ERR("L2CAP connect failed (err %d)", err);
+    }
+}
+
+/* 发送一个 SDU (分段和信用由协议栈处理) */
+static int l2cap_write(const uint8_t *data, uint16_t len)
+{
+    struct net_buf *buf = net_buf_alloc(&l2cap_tx_pool, K_FOREVER);
+    int err;
+
+    net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+    net_buf_add_mem(buf, data, len);
+
+    err = bt_l2cap_chan_send(&l2cap_chan.chan, buf);
+    if (err < 0) {
+        net_buf_unref(buf);
+        return err;
+    }
+    return 0;
+}
+
+#endif /* CONFIG_APP_CENTRAL_L2CAP */
+
+static void exchange_func(struct bt_conn *conn, uint8_t att_err,
+                          struct bt_gatt_exchange_params *params)
+{
+    int err;
+
+    LOG_INF("MTU exchange %s, MTU %u", att_err ? "failed" : "done", bt_gatt_get_mtu(conn));
+
+#if defined(CONFIG_APP_CENTRAL_L2CAP)
+    /* L2CAP 模式不需要发现 NUS，直接打开透传通道 */
+    l2cap_open(conn);
+    return;
+#endif
+
+    discover_params.uuid = NULL;
+    discover_params.func = discover_func;
+    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    err = bt_gatt_discover(conn, &discover_params);
+    if (err) {
+        LOG_ERR("Discover failed (err %d)", err);
+    }
+}
+
+static struct bt_gatt_exchange_params exchange_params = {
+    .func = exchange_func,
+};
+
+#if !defined(CONFIG_APP_CENTRAL_L2CAP)
+/* 一条写命令已经发出，窗口腾出一个空位 */
+static void write_done(struct bt_conn *conn, void *user_data)
+{
+    k_sem_give(&tx_window);
+}
+#endif
+
+/* 链路是否可以开始写入 */
+static bool link_writable(void)
+{
+#if defined(CONFIG_APP_CENTRAL_L2CAP)
+    return atomic_get(&l2cap_ready);
+#else
+    return default_conn && nus_rx_handle;
+#endif
+}
+
+/* 当前一次写入的最大负载 */
+static uint16_t link_payload_len(void)
+{
+#if defined(CONFIG_APP_CENTRAL_L2CAP)
+    return MIN(l2cap_chan.tx.mtu, L2CAP_BRIDGE_SDU_LEN);
+#else
+    return bt_gatt_get_mtu(default_conn) - 3;
+#endif
+}
+
+/* 写入一包 (调用前已经占用了一个写入窗口) */
+static int link_write(const uint8_t *data, uint16_t len)
+{
+#if defined(CONFIG_APP_CENTRAL_L2CAP)
+    return l2cap_write(data, len);
+#else
+    return bt_gatt_write_without_response_cb(default_conn, nus_rx_handle, data, len,
+                                             false, write_done, NULL);
+#endif
+}
+
+/* ----------------连接管理---------------- */
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    const struct bt_conn_le_phy_param phy = {
+        .options = BT_CONN_LE_PHY_OPT_NONE,
+        .pref_tx_phy = BT_GAP_LE_PHY_2M,
+        .pref_rx_phy = BT_GAP_LE_PHY_2M,
+    };
+    int ret;
+
+    if (err) {
+        LOG_ERR("Connection failed (err 0x%02x)", err);
+        bt_conn_unref(default_conn);
+        default_conn = NULL;
+        start_scan();
+        return;
+    }
+
+    if (conn != default_conn) {
+        return;
+    }
+
+    LOG_INF("Connected");
+
+    ret = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (ret) {
+        LOG_WRN("Data length update failed (err %d)", ret);
+    }
+
+    if (IS_ENABLED(CONFIG_APP_CENTRAL_PHY_2M)) {
+        ret = bt_conn_le_phy_update(conn, &phy);
+        if (ret) {
+            LOG_WRN("PHY update failed (err %d)", ret);
+        }
+    }
+
+    ret = bt_gatt_exchange_mtu(conn, &exchange_params);
+    if (ret) {
+        LOG_ERR("MTU exchange failed (err %d)", ret);
+    }
+
+#if defined(CONFIG_APP_CENTRAL_EATT)
+    /* EATT 要求链路已加密，加密完成后协议栈自动建立 EATT 信道 */
+    ret = bt_conn_set_security(conn, BT_SECURITY_L2);
+    if (ret) {
+        LOG_WRN("Set security failed (err %d)", ret);
+    }
+#endif
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    if (conn != default_conn) {
+        return;
+    }
+
+    LOG_INF("Disconnected (reason 0x%02x)", reason);
+    k_work_cancel_delayable(&report_work);
+#if CONFIG_APP_CENTRAL_RUN_MS > 0
+    k_work_cancel_delayable(&run_end_work);
+#endif
+#if defined(READ_PROBE_ENABLED)
+    k_work_cancel_delayable(&probe_work);
+    probe_busy = false;
+#endif
+
+    bt_conn_unref(default_conn);
+    default_conn = NULL;
+    nus_tx_handle = 0;
+    nus_rx_handle = 0;
+    nus_flow_handle = 0;
+    rx_synced = false;
+
+    /* 断开后在途写命令不会再有完成回调，把窗口还满，唤醒可能阻塞的写线程 */
+    for (int i = 0; i < MY_NUS_TX_WINDOW; i++) {
+        k_sem_give(&tx_window);
+    }
+
+#if CONFIG_APP_CENTRAL_RUN_MS > 0
+    /* 测试已经结束，不再重连 */
+    if (run_done) {
+        return;
+    }
+#endif
+    start_scan();
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+};
+
+/* ----------------扫描---------------- */
+
+/* 解析广播数据，查找 NUS Service UUID */
+static bool ad_has_nus(struct bt_data *data, void *user_data)
+{
+    bool *found = user_data;
+
+    if ((data->type == BT_DATA_UUID128_ALL || data->type == BT_DATA_UUID128_SOME) &&
+        data->data_len == BT_UUID_SIZE_128 &&
+        !memcmp(data->data, BT_UUID_128(BT_UUID_MY_NUS_SERVICE)->val, BT_UUID_SIZE_128)) {
+        *found = true;
+        return false;
+    }
+    return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+                         struct net_buf_simple *ad)
+{
+    struct bt_le_conn_param param = BT_LE_CONN_PARAM_INIT(
+        CONFIG_APP_CENTRAL_CONN_INTERVAL, CONFIG_APP_CENTRAL_CONN_INTERVAL, 0, 400);
+    bool found = false;
+    int err;
+
+    if (default_conn || type != BT_GAP_ADV_TYPE_ADV_IND) {
+        return;
+    }
+
+    bt_data_parse(ad, ad_has_nus, &found);
+    if (!found) {
+        return;
+    }
+
+    if (bt_le_scan_stop()) {
+        return;
+    }
+
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, &param, &default_conn);
+    if (err) {
+        LOG_ERR("Create connection failed (err %d)", err);
+        start_scan();
+    }
+}
+
+static void start_scan(void)
+{
+    int err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+
+    if (err) {
+        LOG_ERR("Scanning failed to start (err %d)", err);
+        return;
+    }
+    LOG_INF("Scanning for NUS peripheral...");
+}
+
+/* ----------------主函数---------------- */
+
+int main(void)
+{
+    static uint8_t tx_buf[MAX(CONFIG_BT_L2CAP_TX_MTU - 3, L2CAP_BRIDGE_SDU_LEN)];
+    int err;
+
+    k_work_init_delayable(&report_work, report_work_handler);
+#if CONFIG_APP_CENTRAL_RUN_MS > 0
+    k_work_init_delayable(&run_end_work, run_end_work_handler);
+#endif
+#if defined(READ_PROBE_ENABLED)
+    k_work_init_delayable(&probe_work, probe_work_handler);
+#endif
+
+    err = bt_enable(NULL);
+    if (err) {
+        LOG_ERR("Bluetooth init failed (err %d)", err);
+        return 0;
+    }
+
+    start_scan();
+
+    if (!IS_ENABLED(CONFIG_APP_CENTRAL_WRITE)) {
+        return 0;
+    }
+
+    /* 接收端测试：链路就绪后，用 Write Without Response (或 L2CAP SDU) 全速写入计数流 */
+    while (1) {
+        k_sem_take(&link_ready, K_FOREVER);
+
+        while (link_writable()) {
+            uint16_t len = MIN(link_payload_len(), sizeof(tx_buf));
+            uint8_t *data = tx_buf;
+            uint8_t start = tx_next;
+
+            k_sem_take(&tx_window, K_FOREVER);
+            if (!default_conn) {
+                break;
+            }
+
+#if defined(CONFIG_APP_CENTRAL_MUX)
+            /* 计数流走控制台通道，每包一个帧 */
+            len -= MUX_OVERHEAD;
+            data += MUX_HDR_LEN;
+#endif
+            for (uint16_t i = 0; i < len; i++) {
+                data[i] = tx_next++;
+            }
+
+#if defined(CONFIG_APP_CENTRAL_MUX)
+            err = link_write(tx_buf, mux_frame_put(tx_buf, MUX_CH_CONSOLE, data, len));
+#else
+            err = link_write(tx_buf, len);
+#endif
+            if (err) {
+                /* 协议栈缓冲区满：回退计数，稍后重发同一段数据 */
+                tx_next = start;
+                k_sem_give(&tx_window);
+                k_sleep(K_MSEC(1));
+                continue;
+            }
+            atomic_add(&stat_tx_bytes, len);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * Module: L2CAP CoC Bridge
+ * Description: L2CAP 透传通道实现
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/logging/log.h>
+
+#include "l2cap_bridge.h"
+
+LOG_MODULE_REGISTER(l2cap_bridge, LOG_LEVEL_INF);
+
+/* 每个连接同时在途的 SDU 数量 (每个 SDU 约 4 个空口包) */
+#define L2CAP_BRIDGE_TX_SDUS  3
+
+NET_BUF_POOL_FIXED_DEFINE(bridge_tx_pool, L2CAP_BRIDGE_TX_SDUS * CONFIG_BT_MAX_CONN,
+                          BT_L2CAP_SDU_BUF_SIZE(L2CAP_BRIDGE_SDU_LEN),
+                          CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+
+/*
+ * 接收重组用的缓冲区
+ * 提供了 alloc_buf 后协议栈只发放一个 SDU 的初始信用，
+ * 所以每个连接同一时间最多只有一个 SDU 被暂存，每个连接两个缓冲区足够。
+ */
+NET_BUF_POOL_FIXED_DEFINE(bridge_rx_pool, 2 * CONFIG_BT_MAX_CONN,
+                          BT_L2CAP_SDU_BUF_SIZE(L2CAP_BRIDGE_SDU_LEN), 8, NULL);
+
+/* 每个连接一个透传通道 (按 bt_conn_index 索引) */
+struct bridge_chan {
+    struct bt_l2cap_le_chan le;
+    atomic_t connected;
+    atomic_t tx_in_flight;
+    /* 下行缓冲区满时暂存的 SDU (信用未归还)，由 rx_lock 保护 */
+    struct net_buf *rx_pending;
+};
+
+static struct bridge_chan bridge_chans[CONFIG_BT_MAX_CONN];
+static struct my_nus_cb bridge_cb;
+/* rx_lock 只保护 rx_pending 指针的取出/存入，上层回调在锁外执行 */
+static struct k_spinlock rx_lock;
+/* l2cap_bridge_rx_resume 每运行一次加 1，用来发现存入 rx_pending 之前错过的 resume */
+static atomic_t rx_resume_gen;
+
+static struct bridge_chan *chan_to_bridge(struct bt_l2cap_chan *chan)
+{
+    return CONTAINER_OF(BT_L2CAP_LE_CHAN(chan), struct bridge_chan, le);
+}
+
+static struct bridge_chan *conn_to_bridge(struct bt_conn *conn)
+{
+    return &bridge_chans[bt_conn_index(conn)];
+}
+
+/* ----------------通道回调---------------- */
+
+static struct net_buf *chan_alloc_buf(struct bt_l2cap_chan *chan)
+{
+    return net_buf_alloc(&bridge_rx_pool, K_FOREVER);
+}
+
+static void chan_connected_cb(struct bt_l2cap_chan *chan)
+{
+    struct bridge_chan *bc = chan_to_bridge(chan);
+
+    LOG_INF("L2CAP bridge connected: tx mtu %u mps %u, rx mtu %u mps %u",
+            bc->le.tx.mtu, bc->le.tx.mps, bc->le.rx.mtu, bc->le.rx.mps);
+    atomic_set(&bc->connected, 1);
+
+    if (bridge_cb.send_enabled) {
+        bridge_cb.send_enabled();
+    }
+}
+
+static void chan_disconnected_cb(struct bt_l2cap_chan *chan)
+{
+    struct bridge_chan *bc = chan_to_bridge(chan);
+    k_spinlock_key_t key;
+    struct net_buf *buf;
+
+    LOG_INF("L2CAP bridge disconnected");
+    atomic_clear(&bc->connected);
+    atomic_clear(&bc->tx_in_flight);
+
+    key = k_spin_lock(&rx_lock);
+    buf = bc->rx_pending;
+    bc->rx_pending = NULL;
+    k_spin_unlock(&rx_lock, key);
+
+    if (buf) {
+        net_buf_unref(buf);
+    }
+}
+
+/*
+ * 把一个 SDU 交给上层，返回 true 表示已交付
+ * 放不下就存为 rx_pending，暂不归还信用，对端用完手里的信用就会停发。
+ * 回调 (写下行缓冲区、可能还会发送) 不在锁内执行；如果回调期间有 resume 跑过，
+ * 它可能在存入之前就检查完了，这时把 SDU 收回来再试一次，免得没人再唤醒。
+ */
+static bool rx_deliver(struct bridge_chan *bc, struct net_buf *buf)
+{
+    k_spinlock_key_t key;
+    atomic_val_t gen;
+    bool taken;
+
+    do {
+        gen = atomic_get(&rx_resume_gen);
+        if (!bridge_cb.received(bc->le.chan.conn, buf->data, buf->len)) {
+            return true;
+        }
+
+        key = k_spin_lock(&rx_lock);
+        bc->rx_pending = buf;
+        k_spin_unlock(&rx_lock, key);
+
+        if (gen == atomic_get(&rx_resume_gen)) {
+            return false;
+        }
+
+        key = k_spin_lock(&rx_lock);
+        taken = (bc->rx_pending == buf);
+        if (taken) {
+            bc->rx_pending = NULL;
+        }
+        k_spin_unlock(&rx_lock, key);
+    } while (taken);
+
+    /* 已经被另一次 resume 接手，由它归还信用 */
+    return false;
+}
+
+/* 收到一个完整 SDU (运行在蓝牙 RX 线程) */
+static int chan_recv_cb(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+    if (!bridge_cb.received) {
+        return 0;
+    }
+
+    return rx_deliver(chan_to_bridge(chan), buf) ? 0 : -EINPROGRESS;
+}
+
+/* 一个 SDU 的所有分段都已发出 */
+static void chan_sent_cb(struct bt_l2cap_chan *chan)
+{
+    atomic_t *in_flight = &chan_to_bridge(chan)->tx_in_flight;
+    atomic_val_t old;
+
+    /* 断开时计数已被清零，晚到的回调不能把计数减成负数 */
+    do {
+        old = atomic_get(in_flight);
+        if (old == 0) {
+            break;
+        }
+    } while (!atomic_cas(in_flight, old, old - 1));
+
+    if (bridge_cb.sent) {
+        bridge_cb.sent(chan->conn);
+    }
+}
+
+static const struct bt_l2cap_chan_ops bridge_chan_ops = {
+    .alloc_buf = chan_alloc_buf,
+    .connected = chan_connected_cb,
+    .disconnected = chan_disconnected_cb,
+    .recv = chan_recv_cb,
+    .sent = chan_sent_cb,
+};
+
+/* ----------------服务端---------------- */
+
+static int server_accept(struct bt_conn *conn, struct bt_l2cap_server *server,
+                         struct bt_l2cap_chan **chan)
+{
+    struct bridge_chan *bc = conn_to_bridge(conn);
+
+    /* 每个连接只允许一个透传通道 */
+    if (atomic_get(&bc->connected)) {
+        LOG_WRN("L2CAP bridge already in use");
+        return -ENOMEM;
+    }
+
+    memset(bc, 0, sizeof(*bc));
+    bc->le.chan.ops = &bridge_chan_ops;
+    bc->le.rx.mtu = L2CAP_BRIDGE_SDU_LEN;
+    *chan = &bc->le.chan;
+
+    return 0;
+}
+
+static struct bt_l2cap_server bridge_server = {
+    .psm = L2CAP_BRIDGE_PSM,
+    .sec_level = BT_SECURITY_L1,
+    .accept = server_accept,
+};
+
+/* ----------------对外接口---------------- */
+
+int l2cap_bridge_init(const struct my_nus_cb *callbacks)
+{
+    int err;
+
+    if (!callbacks) {
+        return -EINVAL;
+    }
+    bridge_cb = *callbacks;
+
+    err = bt_l2cap_server_register(&bridge_server);
+    if (err) {
+        LOG_ERR("L2CAP server register failed (err %d)", err);
+        return err;
+    }
+
+    LOG_INF("L2CAP bridge listening on PSM 0x%04x", L2CAP_BRIDGE_PSM);
+    return 0;
+}
+
+bool l2cap_bridge_is_connected(struct bt_conn *conn)
+{
+    return atomic_get(&conn_to_bridge(conn)->connected);
+}
+
+uint32_t l2cap_bridge_payload_len(struct bt_conn *conn)
+{
+    return MIN(L2CAP_BRIDGE_SDU_LEN, conn_to_bridge(conn)->le.tx.mtu);
+}
+
+int l2cap_bridge_send(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+{
+    struct bridge_chan *bc = conn_to_bridge(conn);
+    struct net_buf *buf;
+    int err;
+
+    if (!atomic_get(&bc->connected)) {
+        return -ENOTCONN;
+    }
+
+    /* 该连接的 SDU 全部在途：等 chan_sent_cb 回调后再继续，不需要定时重试 */
+    if (atomic_get(&bc->tx_in_flight) >= L2CAP_BRIDGE_TX_SDUS) {
+        return -EAGAIN;
+    }
+
+    buf = net_buf_alloc(&bridge_tx_pool, K_NO_WAIT);
+    if (!buf) {
+        return -EAGAIN;
+    }
+
+    net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+    net_buf_add_mem(buf, data, len);
+
+    atomic_inc(&bc->tx_in_flight);
+    err = bt_l2cap_chan_send(&bc->le.chan, buf);
+    if (err < 0) {
+        atomic_dec(&bc->tx_in_flight);
+        net_buf_unref(buf);
+        LOG_ERR("bt_l2cap_chan_send failed: %d", err);
+        return err;
+    }
+
+    return 0;
+}
+
+uint32_t l2cap_bridge_tx_in_flight(struct bt_conn *conn)
+{
+    return (uint32_t)atomic_get(&conn_to_bridge(conn)->tx_in_flight);
+}
+
+void l2cap_bridge_rx_resume(void)
+{
+    atomic_inc(&rx_resume_gen);
+
+    for (int i = 0; i < ARRAY_SIZE(bridge_chans); i++) {
+        struct bridge_chan *bc = &bridge_chans[i];
+        k_spinlock_key_t key;
+        struct net_buf *buf;
+
+        /* 锁内只取走指针，交付在锁外进行 (还是放不下时 rx_deliver 会重新存回) */
+        key = k_spin_lock(&rx_lock);
+        buf = bc->rx_pending;
+        bc->rx_pending = NULL;
+        k_spin_unlock(&rx_lock, key);
+
+        if (!buf) {
+            continue;
+        }
+        if (!atomic_get(&bc->connected)) {
+            /* 取出之后通道断开了：SDU 直接丢弃 */
+            net_buf_unref(buf);
+            continue;
+        }
+        if (rx_deliver(bc, buf)) {
+            /* 处理完毕，归还这个 SDU 的信用 */
+            bt_l2cap_chan_recv_complete(&bc->le.chan, buf);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Module: L2CAP CoC Bridge
+ * Description: 用 LE Credit Based L2CAP 通道承载 UART 透传数据 (NUS 通知之外的另一种传输方式)
+ *
+ * 对端连接后如果打开了 L2CAP_BRIDGE_PSM 通道，透传数据就改走该通道，否则仍使用 NUS 通知。
+ * 与 NUS 相比：
+ * - 没有 ATT 头，每个 SDU 只有 2 字节长度头，SDU 由协议栈按 MPS 自动分段
+ * - 发送节奏由对端发放的信用 (Credit) 决定，不再需要 -ENOMEM 重试
+ * - 下行缓冲区满时暂不归还信用，对端自然停发 (链路级背压)
+ */
+
+#ifndef L2CAP_BRIDGE_H_
+#define L2CAP_BRIDGE_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "nus.h"
+
+/** @brief 透传通道的 LE PSM (动态范围 0x0080 - 0x00FF) */
+#define L2CAP_BRIDGE_PSM  0x0080
+
+/**
+ * @brief 每个 SDU 的最大负载
+ *
+ * 2 字节 SDU 头 + 986 字节 = 988 = 4 * 247，正好分成 4 个满 MPS 的 PDU，
+ * 每个 PDU 再加 4 字节 L2CAP 头 = 251 字节，填满一个 DLE 空口包。
+ */
+#define L2CAP_BRIDGE_SDU_LEN  986
+
+/** @brief 一个满 SDU 分段后占用的 TX Buffer 数量 */
+#define L2CAP_BRIDGE_SDU_SEGS 4
+
+#if defined(CONFIG_APP_BRIDGE_L2CAP)
+
+/**
+ * @brief 注册 L2CAP 服务端
+ * @param callbacks 与 NUS 共用的回调 (received / sent / send_enabled)
+ * @return 0 成功, 负数 失败
+ */
+int l2cap_bridge_init(const struct my_nus_cb *callbacks);
+
+/** @brief 该连接的对端是否已经打开透传通道 */
+bool l2cap_bridge_is_connected(struct bt_conn *conn);
+
+/** @brief 该连接一个 SDU 能承载的最大负载 (受对端 MTU 限制) */
+uint32_t l2cap_bridge_payload_len(struct bt_conn *conn);
+
+/**
+ * @brief 在该连接的透传通道上发送一个 SDU
+ * @return 0 成功, -EAGAIN 发送缓冲区全部在途 (等 sent 回调), 其他负数 失败
+ */
+int l2cap_bridge_send(struct bt_conn *conn, const uint8_t *data, uint16_t len);
+
+/** @brief 该连接已提交、尚未发送完成的 SDU 数量 */
+uint32_t l2cap_bridge_tx_in_flight(struct bt_conn *conn);
+
+/**
+ * @brief 下行缓冲区腾出空间后调用，重新投递各连接之前被拒绝的 SDU 并归还信用
+ */
+void l2cap_bridge_rx_resume(void);
+
+#else
+
+static inline int l2cap_bridge_init(const struct my_nus_cb *callbacks) { return 0; }
+static inline bool l2cap_bridge_is_connected(struct bt_conn *conn) { return false; }
+static inline uint32_t l2cap_bridge_payload_len(struct bt_conn *conn) { return 0; }
+static inline int l2cap_bridge_send(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+{
+    return -ENOTCONN;
+}
+static inline uint32_t l2cap_bridge_tx_in_flight(struct bt_conn *conn) { return 0; }
+static inline void l2cap_bridge_rx_resume(void) {}
+
+#endif /* CONFIG_APP_BRIDGE_L2CAP */
+
+#endif /* L2CAP_BRIDGE_H_ */
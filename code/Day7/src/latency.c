@@ -0,0 +1,353 @@
+/*
+ * Module: Bridge Latency
+ * Description: 上行延迟时间戳、直方图统计和 Bridge Stats GATT 服务
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include "latency.h"
+
+LOG_MODULE_REGISTER(latency, LOG_LEVEL_INF);
+
+/* ----------------配置部分---------------- */
+/*
+ * 时间标记环 (ingress 和 claim 各一个)
+ * 间隔小于 LATENCY_MERGE_US 的两次记录合并成一个标记 (后面的字节按前一次的时间计算)，
+ * 中断驱动模式下逐 FIFO 的小块写入也不会很快把环转完一圈。
+ */
+#define LATENCY_MARKS      128
+#define LATENCY_MERGE_US   100
+
+/* 每个连接最多记录的在途包数 (大于 NUS 通知窗口和 L2CAP SDU 数) */
+#define LATENCY_IN_FLIGHT  16
+
+/* 一个标记：序号小于 seq_end 的字节在 cyc 时刻 (或之前) 到达 */
+struct latency_mark {
+    uint32_t seq_end;
+    uint32_t cyc;
+};
+
+struct latency_ring {
+    struct latency_mark marks[LATENCY_MARKS];
+    uint32_t written;       /* 累计写入的标记数 */
+    uint32_t seq;           /* 累计字节数 */
+};
+
+/* 一个在途包的时间点；valid 为 false 表示包里没有 UART 数据或者标记已丢失 */
+struct latency_pkt {
+    uint32_t ingress;
+    uint32_t claim;
+    uint32_t submit;
+    bool valid;
+};
+
+/* 每个连接的在途记录 (按 bt_conn_index 索引)：TX 任务写 head，完成回调读 tail */
+struct latency_conn {
+    struct latency_pkt pkts[LATENCY_IN_FLIGHT];
+    atomic_t head;
+    atomic_t tail;
+    uint32_t ingress_cursor;
+    uint32_t claim_cursor;
+};
+
+struct latency_stage_stat {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+    uint32_t hist[LATENCY_BUCKETS];
+};
+
+static struct latency_ring ingress_ring;
+static struct latency_ring claim_ring;
+static struct latency_conn latency_conns[CONFIG_BT_MAX_CONN];
+static struct latency_stage_stat stats[LATENCY_STAGE_COUNT];
+static uint32_t stat_lost;
+
+static const char *const stage_names[LATENCY_STAGE_COUNT] = {
+    "uart", "queue", "stack", "total",
+};
+
+static struct k_work dump_work;
+
+/* ----------------时间标记---------------- */
+
+static void latency_mark(struct latency_ring *ring, uint32_t len)
+{
+    uint32_t now = k_cycle_get_32();
+    struct latency_mark *last = &ring->marks[(ring->written - 1) % LATENCY_MARKS];
+
+    if (len == 0) {
+        return;
+    }
+    ring->seq += len;
+
+    if (ring->written && now - last->cyc < k_us_to_cyc_ceil32(LATENCY_MERGE_US)) {
+        last->seq_end = ring->seq;
+        return;
+    }
+
+    ring->marks[ring->written % LATENCY_MARKS] = (struct latency_mark) {
+        .seq_end = ring->seq,
+        .cyc = now,
+    };
+    /* 先写好标记再发布，读者看到 written 时内容已经有效 */
+    compiler_barrier();
+    ring->written++;
+}
+
+/*
+ * 查找序号为 seq 的字节的时间点
+ * 每个连接的字节序号单调递增，所以各自保存一个游标顺序向前查找。
+ * 游标被写者超过一圈 (标记已被覆盖) 时放弃本次统计。
+ */
+static bool latency_lookup(const struct latency_ring *ring, uint32_t *cursor, uint32_t seq,
+                           uint32_t *cyc)
+{
+    uint32_t written = ring->written;
+
+    if (written - *cursor > LATENCY_MARKS) {
+        *cursor = written - LATENCY_MARKS;
+        return false;
+    }
+
+    while (*cursor != written &&
+           (int32_t)(ring->marks[*cursor % LATENCY_MARKS].seq_end - seq) <= 0) {
+        (*cursor)++;
+    }
+    if (*cursor == written) {
+        return false;
+    }
+
+    *cyc = ring->marks[*cursor % LATENCY_MARKS].cyc;
+    return true;
+}
+
+/* ----------------直方图---------------- */
+
+static void latency_record(enum latency_stage stage, uint32_t cycles)
+{
+    struct latency_stage_stat *st = &stats[stage];
+    uint32_t us = k_cyc_to_us_floor32(cycles);
+    uint32_t idx = 0;
+
+    if (us >= LATENCY_BUCKET0_US) {
+        idx = MIN(32 - __builtin_clz(us / LATENCY_BUCKET0_US), LATENCY_BUCKETS - 1);
+    }
+
+    st->count++;
+    st->sum_us += us;
+    st->max_us = MAX(st->max_us, us);
+    st->hist[idx]++;
+}
+
+void latency_ingress(uint32_t len)
+{
+    latency_mark(&ingress_ring, len);
+}
+
+uint32_t latency_claim(uint32_t len)
+{
+    uint32_t seq = claim_ring.seq;
+
+    latency_mark(&claim_ring, len);
+    return seq;
+}
+
+void latency_conn_reset(struct bt_conn *conn)
+{
+    struct latency_conn *lc = &latency_conns[bt_conn_index(conn)];
+
+    atomic_set(&lc->head, 0);
+    atomic_set(&lc->tail, 0);
+
+    /* 还留在 uart_ring_buf 里的字节可能在连接之前就到了，从最老的标记开始找 */
+    lc->ingress_cursor = ingress_ring.written - MIN(ingress_ring.written, LATENCY_MARKS);
+    lc->claim_cursor = claim_ring.written - MIN(claim_ring.written, LATENCY_MARKS);
+}
+
+void latency_submit(struct bt_conn *conn, uint32_t seq, uint32_t raw)
+{
+    struct latency_conn *lc = &latency_conns[bt_conn_index(conn)];
+    uint32_t head = (uint32_t)atomic_get(&lc->head);
+    struct latency_pkt *pkt = &lc->pkts[head % LATENCY_IN_FLIGHT];
+
+    if (head - (uint32_t)atomic_get(&lc->tail) >= LATENCY_IN_FLIGHT) {
+        /* 理论上不会发生 (在途数受窗口限制)；记录满了就不再跟踪，完成回调会对不上 */
+        stat_lost++;
+        return;
+    }
+
+    pkt->submit = k_cycle_get_32();
+    pkt->valid = raw &&
+                 latency_lookup(&ingress_ring, &lc->ingress_cursor, seq, &pkt->ingress) &&
+                 latency_lookup(&claim_ring, &lc->claim_cursor, seq, &pkt->claim);
+    if (raw && !pkt->valid) {
+        stat_lost++;
+    }
+
+    atomic_set(&lc->head, head + 1);
+}
+
+void latency_cancel(struct bt_conn *conn)
+{
+    atomic_dec(&latency_conns[bt_conn_index(conn)].head);
+}
+
+void latency_sent(struct bt_conn *conn)
+{
+    struct latency_conn *lc = &latency_conns[bt_conn_index(conn)];
+    uint32_t tail = (uint32_t)atomic_get(&lc->tail);
+    struct latency_pkt *pkt;
+    uint32_t now = k_cycle_get_32();
+
+    if (tail == (uint32_t)atomic_get(&lc->head)) {
+        return;
+    }
+
+    pkt = &lc->pkts[tail % LATENCY_IN_FLIGHT];
+    if (pkt->valid) {
+        latency_record(LATENCY_STAGE_UART, pkt->claim - pkt->ingress);
+        latency_record(LATENCY_STAGE_QUEUE, pkt->submit - pkt->claim);
+        latency_record(LATENCY_STAGE_STACK, now - pkt->submit);
+        latency_record(LATENCY_STAGE_TOTAL, now - pkt->ingress);
+    }
+
+    atomic_set(&lc->tail, tail + 1);
+}
+
+void latency_reset(void)
+{
+    memset(stats, 0, sizeof(stats));
+    stat_lost = 0;
+}
+
+void latency_dump(void)
+{
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) {
+        const struct latency_stage_stat *st = &stats[s];
+
+        if (st->count == 0) {
+            continue;
+        }
+        printk("Latency %-5s: n %u, avg %u us, max %u us\n", stage_names[s], st->count,
+               (uint32_t)(st->sum_us / st->count), st->max_us);
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            if (st->hist[i]) {
+                printk("    < %7u us: %u\n",
+                       i == LATENCY_BUCKETS - 1 ? UINT32_MAX : LATENCY_BUCKET0_US << i,
+                       st->hist[i]);
+            }
+        }
+    }
+    if (stat_lost) {
+        printk("Latency: %u pkts not tracked\n", stat_lost);
+    }
+}
+
+static void dump_work_handler(struct k_work *work)
+{
+    latency_dump();
+}
+
+/* ----------------Bridge Stats GATT 服务---------------- */
+
+/* 长读取分多次请求：offset 为 0 时拍一次快照，后续请求都读同一份 */
+static struct latency_report report;
+
+static void latency_snapshot(void)
+{
+    report.version = 1;
+    report.stages = LATENCY_STAGE_COUNT;
+    report.buckets = LATENCY_BUCKETS;
+    report.bucket0_us = sys_cpu_to_le16(LATENCY_BUCKET0_US);
+    report.lost = sys_cpu_to_le16(MIN(stat_lost, UINT16_MAX));
+
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) {
+        const struct latency_stage_stat *st = &stats[s];
+
+        report.stage[s].count = sys_cpu_to_le32(st->count);
+        report.stage[s].avg_us = sys_cpu_to_le32(st->count ? st->sum_us / st->count : 0);
+        report.stage[s].max_us = sys_cpu_to_le32(st->max_us);
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            report.stage[s].hist[i] = sys_cpu_to_le32(st->hist[i]);
+        }
+    }
+}
+
+static ssize_t on_read_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                             void *buf, uint16_t len, uint16_t offset)
+{
+    if (offset == 0) {
+        latency_snapshot();
+    }
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &report, sizeof(report));
+}
+
+static ssize_t on_write_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    if (offset || len != 1) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    switch (((const uint8_t *)buf)[0]) {
+    case LATENCY_CMD_RESET:
+        latency_reset();
+        break;
+    case LATENCY_CMD_DUMP:
+        k_work_submit(&dump_work);
+        break;
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+    return len;
+}
+
+BT_GATT_SERVICE_DEFINE(latency_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_LATENCY_SERVICE),
+    BT_GATT_CHARACTERISTIC(BT_UUID_LATENCY_STATS,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                           on_read_stats, on_write_stats, NULL),
+);
+
+/* ----------------按键触发 RTT 打印---------------- */
+
+#if DT_NODE_HAS_STATUS(DT_ALIAS(sw0), okay)
+static const struct gpio_dt_spec dump_button = GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios);
+static struct gpio_callback dump_button_cb;
+
+/* 按键中断：打印比较慢，交给工作队列 */
+static void dump_button_pressed(const struct device *dev, struct gpio_callback *cb,
+                                uint32_t pins)
+{
+    k_work_submit(&dump_work);
+}
+
+static void dump_button_init(void)
+{
+    if (!gpio_is_ready_dt(&dump_button)) {
+        return;
+    }
+    gpio_pin_configure_dt(&dump_button, GPIO_INPUT);
+    gpio_pin_interrupt_configure_dt(&dump_button, GPIO_INT_EDGE_TO_ACTIVE);
+    gpio_init_callback(&dump_button_cb, dump_button_pressed, BIT(dump_button.pin));
+    gpio_add_callback(dump_button.port, &dump_button_cb);
+}
+#else
+static void dump_button_init(void)
+{
+}
+#endif
+
+void latency_init(void)
+{
+    k_work_init(&dump_work, dump_work_handler);
+    dump_button_init();
+}
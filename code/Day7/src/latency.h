@@ -0,0 +1,126 @@
+/*
+ * Module: Bridge Latency
+ * Description: 上行 (UART → BLE) 逐字节延迟直方图
+ *
+ * 一个字节从进入 uart_ring_buf 到所在的包发送完成，经过 4 个时间点：
+ *   ingress: UART 中断 (异步模式下为 DMA 提交) 把字节写进 uart_ring_buf
+ *   claim:   发送任务 (ble_tx_pump) 把字节从 uart_ring_buf 取出，分发到连接队列
+ *   submit:  字节所在的包交给 bt_gatt_notify_cb (或 L2CAP)
+ *   sent:    该包的发送完成回调
+ * 每包只跟踪第一个 (最老的) 原始字节，按阶段汇总成固定分桶的直方图：
+ * 桶 0 为 < 64 us，桶 i 为 [64 << (i - 1), 64 << i) us，最后一个桶不封顶。
+ *
+ * 热路径上只有记录时间戳和几次数组写入：
+ * 中断里每次提交记一个 (累计字节数, 时间) 标记，相邻很近的提交合并成一个；
+ * 查表、换算和统计都在发送完成回调里进行。
+ *
+ * 读取方式：
+ *   - GATT: Bridge Stats 服务的统计特征值 (长读取，格式见 struct latency_report)；
+ *     写入 LATENCY_CMD_DUMP 打印到 RTT，写入 LATENCY_CMD_RESET 清零
+ *   - RTT:  按下 sw0 按键，或最后一个连接断开时打印
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+
+/** @brief Bridge Stats Service UUID: 6E400010-B5A3-F393-E0A9-E50E24DCCA9E (非标准 NUS 扩展) */
+#define LATENCY_UUID_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x6E400010, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
+
+/** @brief 延迟统计 Characteristic UUID (Read | Write): ...0011... */
+#define LATENCY_UUID_STATS_VAL \
+    BT_UUID_128_ENCODE(0x6E400011, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
+
+#define BT_UUID_LATENCY_SERVICE  BT_UUID_DECLARE_128(LATENCY_UUID_SERVICE_VAL)
+#define BT_UUID_LATENCY_STATS    BT_UUID_DECLARE_128(LATENCY_UUID_STATS_VAL)
+
+/** @brief 写入统计特征值的命令 */
+#define LATENCY_CMD_RESET  0x00
+#define LATENCY_CMD_DUMP   0x01
+
+/** @brief 统计阶段 */
+enum latency_stage {
+    LATENCY_STAGE_UART,     /**< ingress → claim: 在 uart_ring_buf 中排队 */
+    LATENCY_STAGE_QUEUE,    /**< claim → submit: 连接队列、打包等待、DRR、在途窗口 */
+    LATENCY_STAGE_STACK,    /**< submit → sent: 协议栈缓冲和空口 */
+    LATENCY_STAGE_TOTAL,    /**< ingress → sent */
+    LATENCY_STAGE_COUNT,
+};
+
+#define LATENCY_BUCKETS     16
+#define LATENCY_BUCKET0_US  64
+
+/** @brief GATT 读取到的统计格式 (小端) */
+struct latency_report {
+    uint8_t version;        /**< 目前为 1 */
+    uint8_t stages;         /**< LATENCY_STAGE_COUNT */
+    uint8_t buckets;        /**< LATENCY_BUCKETS */
+    uint8_t reserved;
+    uint16_t bucket0_us;    /**< LATENCY_BUCKET0_US */
+    uint16_t lost;          /**< 标记被覆盖、没能统计的包数 */
+    struct {
+        uint32_t count;
+        uint32_t avg_us;
+        uint32_t max_us;
+        uint32_t hist[LATENCY_BUCKETS];
+    } stage[LATENCY_STAGE_COUNT];
+} __packed;
+
+#if defined(CONFIG_APP_BRIDGE_LATENCY)
+
+/** @brief 初始化 (注册 sw0 按键触发打印) */
+void latency_init(void);
+
+/** @brief len 字节已写入 uart_ring_buf (可在中断中调用) */
+void latency_ingress(uint32_t len);
+
+/**
+ * @brief len 字节已从 uart_ring_buf 取出
+ * @return 其中第一个字节的序号 (从开机起累计的字节数)
+ */
+uint32_t latency_claim(uint32_t len);
+
+/** @brief 连接建立：清空该连接的在途记录 */
+void latency_conn_reset(struct bt_conn *conn);
+
+/**
+ * @brief 一包即将交给协议栈
+ *
+ * 必须在发送之前调用 (完成回调可能在发送函数返回前就执行)，发送失败时调用 latency_cancel。
+ *
+ * @param seq 包中第一个原始字节的序号
+ * @param raw 包中原始字节数 (0 表示没有 UART 数据，例如只有控制帧)
+ */
+void latency_submit(struct bt_conn *conn, uint32_t seq, uint32_t raw);
+
+/** @brief 撤销最近一次 latency_submit (发送失败) */
+void latency_cancel(struct bt_conn *conn);
+
+/** @brief 该连接最早的在途包发送完成 */
+void latency_sent(struct bt_conn *conn);
+
+/** @brief 清零直方图 */
+void latency_reset(void);
+
+/** @brief 打印直方图 (printk，Day7 的 Console 为 RTT) */
+void latency_dump(void);
+
+#else
+
+static inline void latency_init(void) {}
+static inline void latency_ingress(uint32_t len) {}
+static inline uint32_t latency_claim(uint32_t len) { return 0; }
+static inline void latency_conn_reset(struct bt_conn *conn) {}
+static inline void latency_submit(struct bt_conn *conn, uint32_t seq, uint32_t raw) {}
+static inline void latency_cancel(struct bt_conn *conn) {}
+static inline void latency_sent(struct bt_conn *conn) {}
+static inline void latency_reset(void) {}
+static inline void latency_dump(void) {}
+
+#endif /* CONFIG_APP_BRIDGE_LATENCY */
+
+#endif /* LATENCY_H_ */
@@ -0,0 +1,427 @@
+/*
+ * Module: Link Bring-up
+ * Description: 链路优化状态机实现
+ *
+ * 状态顺序：
+ *   MTU         bt_gatt_exchange_mtu        → exchange_func
+ *   DLE         bt_conn_le_data_len_update  → le_data_len_updated
+ *   PHY         bt_conn_le_phy_update (2M)  → le_phy_updated
+ *   CONN_PARAM  bt_conn_le_param_update     → le_param_updated
+ *   SECURITY    bt_conn_set_security (L2)   → security_changed      (仅 CONFIG_APP_BRIDGE_EATT)
+ *   EATT        bt_eatt_connect             → 轮询 bt_eatt_count    (仅 CONFIG_APP_BRIDGE_EATT)
+ *   DONE        ready 回调
+ *
+ * 所有请求都从 System WorkQueue 中发出，蓝牙回调只记录结果并唤醒状态机，
+ * 这样不会在蓝牙 RX 线程里发起新的 HCI 命令。
+ *
+ * EATT 信道建立没有完成回调，请求发出后每 LINK_OPT_POLL_INTERVAL 查一次信道数量；
+ * 对端不支持 EATT 时不重试，超时后直接跳过，继续使用传统 ATT 信道。
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/att.h>
+#include <zephyr/logging/log.h>
+
+#include "link_opt.h"
+
+LOG_MODULE_REGISTER(link_opt, LOG_LEVEL_INF);
+
+/* ----------------配置部分---------------- */
+#define LINK_OPT_STEP_TIMEOUT_MS 2000      // 每一步等待完成回调的时间
+#define LINK_OPT_STEP_TIMEOUT  K_MSEC(LINK_OPT_STEP_TIMEOUT_MS)
+#define LINK_OPT_POLL_INTERVAL K_MSEC(20)   // 没有完成回调的步骤 (EATT) 的轮询间隔
+#define LINK_OPT_RETRY_DELAY   K_MSEC(100)  // 请求被拒绝 (例如协议栈忙) 后的重试间隔
+#define LINK_OPT_MAX_RETRIES   2            // 每一步最多重试次数，超过后跳过该步
+
+/* 目标连接参数：默认 30 ms 间隔 (Kconfig)，无从机延迟，4 s 超时 (单位同 BT_LE_CONN_PARAM) */
+#define LINK_OPT_INTERVAL      CONFIG_APP_BRIDGE_CONN_INTERVAL
+#define LINK_OPT_LATENCY       0
+#define LINK_OPT_TIMEOUT       400
+
+/* DLE 目标：本端控制器支持的最大长度 (参数扫描时可能小于 251) */
+#if defined(CONFIG_BT_CTLR_DATA_LENGTH_MAX)
+#define LINK_OPT_DATA_LEN      MIN(BT_GAP_DATA_LEN_MAX, CONFIG_BT_CTLR_DATA_LENGTH_MAX)
+#else
+#define LINK_OPT_DATA_LEN      BT_GAP_DATA_LEN_MAX
+#endif
+
+enum link_step {
+    LINK_STEP_MTU,
+    LINK_STEP_DLE,
+    LINK_STEP_PHY,
+    LINK_STEP_CONN_PARAM,
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    LINK_STEP_SECURITY,
+    LINK_STEP_EATT,
+#endif
+    LINK_STEP_DONE,
+};
+
+static const char *const step_names[] = {
+    [LINK_STEP_MTU] = "MTU",
+    [LINK_STEP_DLE] = "DLE",
+    [LINK_STEP_PHY] = "PHY",
+    [LINK_STEP_CONN_PARAM] = "CONN_PARAM",
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    [LINK_STEP_SECURITY] = "SECURITY",
+    [LINK_STEP_EATT] = "EATT",
+#endif
+    [LINK_STEP_DONE] = "DONE",
+};
+
+/* 完成回调上报的结果 */
+enum link_result {
+    LINK_RESULT_NONE,
+    LINK_RESULT_OK,
+    LINK_RESULT_FAILED,
+};
+
+/* 每个连接的状态机 (按 bt_conn_index 索引) */
+struct link_opt {
+    struct bt_conn *conn;
+    enum link_step step;
+    uint8_t retries;
+    bool waiting;           /* 请求已发出，正在等完成回调 */
+    atomic_t result;        /* enum link_result，由蓝牙回调写入 */
+    int64_t start_ms;       /* 开始优化的时间 */
+    int64_t step_ms;        /* 当前步骤开始的时间 */
+    int64_t req_ms;         /* 当前请求发出的时间 (轮询步骤用来判断超时) */
+    struct k_work_delayable work;
+    struct bt_gatt_exchange_params exchange_params;
+};
+
+static struct link_opt link_opts[CONFIG_BT_MAX_CONN];
+static link_opt_ready_cb_t ready_cb;
+
+static struct link_opt *link_opt_get(struct bt_conn *conn)
+{
+    return &link_opts[bt_conn_index(conn)];
+}
+
+/* 蓝牙回调：如果正好在等这一步，记录结果并唤醒状态机 */
+static void step_complete(struct bt_conn *conn, enum link_step step, bool ok)
+{
+    struct link_opt *lo = link_opt_get(conn);
+
+    if (lo->conn != conn || lo->step != step || !lo->waiting) {
+        return;
+    }
+    atomic_set(&lo->result, ok ? LINK_RESULT_OK : LINK_RESULT_FAILED);
+    k_work_reschedule(&lo->work, K_NO_WAIT);
+}
+
+static void exchange_func(struct bt_conn *conn, uint8_t att_err,
+                          struct bt_gatt_exchange_params *params)
+{
+    if (att_err) {
+        LOG_WRN("MTU exchange failed (err %d)", att_err);
+    }
+    step_complete(conn, LINK_STEP_MTU, !att_err);
+}
+
+/*
+ * 当前链路是否已经满足这一步的目标
+ * 参数本来就是目标值时控制器可能不会产生完成事件，用它避免白等超时
+ */
+static bool step_satisfied(struct link_opt *lo)
+{
+    struct bt_conn_info info;
+
+    if (bt_conn_get_info(lo->conn, &info)) {
+        return false;
+    }
+
+    switch (lo->step) {
+    case LINK_STEP_MTU:
+        return bt_gatt_get_mtu(lo->conn) > 23; // 已经有一方发起过 MTU 交换
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+    case LINK_STEP_DLE:
+        return info.le.data_len->tx_max_len >= LINK_OPT_DATA_LEN;
+#endif
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+    case LINK_STEP_PHY:
+        return info.le.phy->tx_phy == BT_GAP_LE_PHY_2M;
+#endif
+    case LINK_STEP_CONN_PARAM:
+        return info.le.interval == LINK_OPT_INTERVAL && info.le.latency == LINK_OPT_LATENCY;
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    case LINK_STEP_SECURITY:
+        return info.security.level >= BT_SECURITY_L2;
+    case LINK_STEP_EATT:
+        return bt_eatt_count(lo->conn) > 0; // 对端也可能在加密后自己发起
+#endif
+    default:
+        return false;
+    }
+}
+
+/* 发起当前步骤的请求，返回 -EALREADY 表示已经是目标状态，不需要等回调 */
+static int step_request(struct link_opt *lo)
+{
+    switch (lo->step) {
+    case LINK_STEP_MTU:
+        lo->exchange_params.func = exchange_func;
+        return bt_gatt_exchange_mtu(lo->conn, &lo->exchange_params);
+
+    case LINK_STEP_DLE:
+        if (!IS_ENABLED(CONFIG_BT_USER_DATA_LEN_UPDATE)) {
+            return -EALREADY;
+        }
+        return bt_conn_le_data_len_update(lo->conn, BT_LE_DATA_LEN_PARAM_MAX);
+
+    case LINK_STEP_PHY:
+        if (!IS_ENABLED(CONFIG_BT_USER_PHY_UPDATE) || !IS_ENABLED(CONFIG_APP_BRIDGE_PHY_2M)) {
+            return -EALREADY;
+        }
+        return bt_conn_le_phy_update(lo->conn, BT_CONN_LE_PHY_PARAM_2M);
+
+    case LINK_STEP_CONN_PARAM:
+        return bt_conn_le_param_update(lo->conn,
+                                       BT_LE_CONN_PARAM(LINK_OPT_INTERVAL, LINK_OPT_INTERVAL,
+                                                        LINK_OPT_LATENCY, LINK_OPT_TIMEOUT));
+
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    /* EATT 要求链路已加密 (Just Works 即可) */
+    case LINK_STEP_SECURITY:
+        return bt_conn_set_security(lo->conn, BT_SECURITY_L2);
+
+    /* 只建一条 EATT 信道：大批量通知固定走它，传统信道留给控制类流量 */
+    case LINK_STEP_EATT:
+        return bt_eatt_connect(lo->conn, 1);
+#endif
+
+    default:
+        return -EINVAL;
+    }
+}
+
+/* 当前步骤结束 (成功或放弃)，打印耗时并进入下一步 */
+static void step_finish(struct link_opt *lo, const char *how)
+{
+    int64_t now = k_uptime_get();
+
+    LOG_INF("Link step %s %s in %lld ms (retries %u)", step_names[lo->step], how,
+            now - lo->step_ms, lo->retries);
+
+    lo->step++;
+    lo->retries = 0;
+    lo->waiting = false;
+    lo->step_ms = now;
+}
+
+/* 没有完成回调、只能轮询结果的步骤 */
+static bool step_polled(enum link_step step)
+{
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    return step == LINK_STEP_EATT;
+#else
+    return false;
+#endif
+}
+
+/* 全部完成：打印最终链路状态 */
+static void link_report(struct link_opt *lo)
+{
+    struct bt_conn_info info;
+
+    if (bt_conn_get_info(lo->conn, &info)) {
+        return;
+    }
+
+    printk("[LINK %u] ready in %lld ms: mtu %u, interval %u, latency %u",
+           bt_conn_index(lo->conn), k_uptime_get() - lo->start_ms,
+           bt_gatt_get_mtu(lo->conn), info.le.interval, info.le.latency);
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+    printk(", dle tx %u/%u us", info.le.data_len->tx_max_len, info.le.data_len->tx_max_time);
+#endif
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+    printk(", phy tx %u rx %u", info.le.phy->tx_phy, info.le.phy->rx_phy);
+#endif
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    printk(", security %u, eatt %zu", info.security.level, bt_eatt_count(lo->conn));
+#endif
+    printk("\n");
+}
+
+static void link_opt_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct link_opt *lo = CONTAINER_OF(dwork, struct link_opt, work);
+    int err;
+
+    if (!lo->conn || lo->step == LINK_STEP_DONE) {
+        return;
+    }
+
+    /* 1. 处理正在等待的步骤：完成回调到了，或者超时 */
+    if (lo->waiting) {
+        switch (atomic_set(&lo->result, LINK_RESULT_NONE)) {
+        case LINK_RESULT_OK:
+            step_finish(lo, "done");
+            break;
+        case LINK_RESULT_FAILED:
+        default:
+            /* 超时但链路已经是目标状态 (没有产生完成事件)，视为完成 */
+            if (step_satisfied(lo)) {
+                step_finish(lo, "done (no event)");
+                break;
+            }
+            /* 轮询步骤还没到超时时间，继续等 */
+            if (step_polled(lo->step) &&
+                k_uptime_get() - lo->req_ms < LINK_OPT_STEP_TIMEOUT_MS) {
+                k_work_reschedule(&lo->work, LINK_OPT_POLL_INTERVAL);
+                return;
+            }
+            /* 失败或超时：重试，次数用完就跳过 (对端不支持 EATT 时重试也没用) */
+            lo->waiting = false;
+            if (lo->retries >= LINK_OPT_MAX_RETRIES || step_polled(lo->step)) {
+                LOG_WRN("Link step %s gave up", step_names[lo->step]);
+                step_finish(lo, "skipped");
+            } else {
+                lo->retries++;
+            }
+            break;
+        }
+    }
+
+    /* 2. 发起下一步 (已经是目标状态的步骤直接跳过) */
+    while (lo->step < LINK_STEP_DONE) {
+        atomic_set(&lo->result, LINK_RESULT_NONE);
+        lo->waiting = true;
+
+        err = step_satisfied(lo) ? -EALREADY : step_request(lo);
+        if (err == 0) {
+            lo->req_ms = k_uptime_get();
+            k_work_reschedule(&lo->work, step_polled(lo->step) ? LINK_OPT_POLL_INTERVAL
+                                                               : LINK_OPT_STEP_TIMEOUT);
+            return;
+        }
+
+        if (err == -EALREADY) {
+            step_finish(lo, "already set");
+            continue;
+        }
+
+        /* 请求没发出去 (例如协议栈忙)，稍后重试 */
+        LOG_WRN("Link step %s request failed (err %d)", step_names[lo->step], err);
+        lo->waiting = false;
+        if (lo->retries >= LINK_OPT_MAX_RETRIES) {
+            step_finish(lo, "skipped");
+            continue;
+        }
+        lo->retries++;
+        k_work_reschedule(&lo->work, LINK_OPT_RETRY_DELAY);
+        return;
+    }
+
+    link_report(lo);
+    if (ready_cb) {
+        ready_cb(lo->conn);
+    }
+}
+
+/* ----------------连接回调---------------- */
+
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+    LOG_INF("Data length updated: tx %u bytes / %u us, rx %u bytes / %u us",
+            info->tx_max_len, info->tx_max_time, info->rx_max_len, info->rx_max_time);
+    step_complete(conn, LINK_STEP_DLE, true);
+}
+#endif
+
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    LOG_INF("PHY updated: tx %u, rx %u", param->tx_phy, param->rx_phy);
+    step_complete(conn, LINK_STEP_PHY, true);
+}
+#endif
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+                             uint16_t latency, uint16_t timeout)
+{
+    /* 对端可能只部分接受 (例如间隔取了别的值)，同样视为完成 */
+    step_complete(conn, LINK_STEP_CONN_PARAM, true);
+}
+
+#if defined(CONFIG_APP_BRIDGE_EATT)
+static void security_changed(struct bt_conn *conn, bt_security_t level,
+                             enum bt_security_err err)
+{
+    if (err) {
+        LOG_WRN("Security failed (level %u, err %d)", level, err);
+    }
+    step_complete(conn, LINK_STEP_SECURITY, !err);
+}
+#endif
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct link_opt *lo = link_opt_get(conn);
+
+    if (lo->conn != conn) {
+        return;
+    }
+
+    k_work_cancel_delayable(&lo->work);
+    if (lo->step != LINK_STEP_DONE) {
+        LOG_WRN("Disconnected during link step %s", step_names[lo->step]);
+    }
+    bt_conn_unref(lo->conn);
+    lo->conn = NULL;
+}
+
+BT_CONN_CB_DEFINE(link_opt_conn_callbacks) = {
+    .disconnected = disconnected,
+    .le_param_updated = le_param_updated,
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+    .le_data_len_updated = le_data_len_updated,
+#endif
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+    .le_phy_updated = le_phy_updated,
+#endif
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    .security_changed = security_changed,
+#endif
+};
+
+/* ----------------对外接口---------------- */
+
+void link_opt_init(link_opt_ready_cb_t ready)
+{
+    ready_cb = ready;
+
+    for (int i = 0; i < ARRAY_SIZE(link_opts); i++) {
+        k_work_init_delayable(&link_opts[i].work, link_opt_work_handler);
+    }
+}
+
+void link_opt_start(struct bt_conn *conn)
+{
+    struct link_opt *lo = link_opt_get(conn);
+
+    if (lo->conn) {
+        bt_conn_unref(lo->conn);
+    }
+    lo->conn = bt_conn_ref(conn);
+    lo->step = LINK_STEP_MTU;
+    lo->retries = 0;
+    lo->waiting = false;
+    atomic_set(&lo->result, LINK_RESULT_NONE);
+    lo->start_ms = k_uptime_get();
+    lo->step_ms = lo->start_ms;
+
+    k_work_reschedule(&lo->work, K_NO_WAIT);
+}
+
+bool link_opt_is_ready(struct bt_conn *conn)
+{
+    struct link_opt *lo = link_opt_get(conn);
+
+    return lo->conn == conn && lo->step == LINK_STEP_DONE;
+}
@@ -0,0 +1,35 @@
+/*
+ * Module: Link Bring-up
+ * Description: 连接建立后按顺序优化链路 (MTU → DLE → PHY → 连接参数 [→ 加密 → EATT])
+ *
+ * 每一步都等上一步的完成回调 (或超时) 后才开始，失败/超时会重试，
+ * 多次失败则跳过该步继续后面的步骤。全部完成后调用 ready 回调，
+ * 调用者在此之后才开始大批量发送。每一步的耗时都会打印出来。
+ */
+
+#ifndef LINK_OPT_H_
+#define LINK_OPT_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief 链路优化完成回调 (在 System WorkQueue 中执行) */
+typedef void (*link_opt_ready_cb_t)(struct bt_conn *conn);
+
+/**
+ * @brief 初始化模块
+ * @param ready 每个连接优化完成时调用
+ */
+void link_opt_init(link_opt_ready_cb_t ready);
+
+/**
+ * @brief 连接建立后开始链路优化 (在 connected 回调中调用)
+ */
+void link_opt_start(struct bt_conn *conn);
+
+/**
+ * @brief 该连接的链路是否已经优化完成
+ */
+bool link_opt_is_ready(struct bt_conn *conn);
+
+#endif /* LINK_OPT_H_ */
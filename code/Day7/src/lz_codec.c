@@ -0,0 +1,220 @@
+/*
+ * Module: LZ Stream Codec
+ * Description: LZSS 编码/解码实现
+ *
+ * 编码器每个位置只查哈希表里最近的一个候选 (不走链表)，每字节开销固定，
+ * 对日志文本和重复的遥测数据已经足够；解码器只做查表和拷贝。
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "lz_codec.h"
+
+#define LZ_WINDOW_MASK  (LZ_WINDOW_SIZE - 1)
+
+static inline uint32_t lz_hash(const uint8_t *p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+void lz_encoder_init(struct lz_encoder *enc)
+{
+    memset(enc->head, 0, sizeof(enc->head));
+    enc->hist_len = 0;
+    enc->base = 0;
+    enc->reset = true;
+}
+
+/* 记录 buf[p] 开始的 3 字节，返回上一次出现的位置 (buf 下标，-1 表示没有可用候选) */
+static int32_t lz_insert(struct lz_encoder *enc, uint32_t p)
+{
+    uint32_t *slot = &enc->head[lz_hash(&enc->buf[p])];
+    uint32_t abs_p = enc->base + p;
+    uint32_t cand = *slot;
+
+    *slot = abs_p + 1;
+
+    /* 候选必须还在 buf 里，并且在窗口距离之内 */
+    if (cand == 0 || cand - 1 < enc->base || abs_p - (cand - 1) > LZ_WINDOW_SIZE) {
+        return -1;
+    }
+    return (int32_t)(cand - 1 - enc->base);
+}
+
+/* 本帧结束：把已编码的数据并入历史，只保留最后 LZ_WINDOW_SIZE 字节 */
+static void lz_commit(struct lz_encoder *enc, uint32_t used)
+{
+    uint32_t total = enc->hist_len + used;
+    uint32_t keep = total < LZ_WINDOW_SIZE ? total : LZ_WINDOW_SIZE;
+
+    memmove(enc->buf, enc->buf + total - keep, keep);
+    enc->base += total - keep;
+    enc->hist_len = keep;
+}
+
+uint32_t lz_encode_frame(struct lz_encoder *enc, const uint8_t *raw, uint32_t raw_len,
+                         uint8_t *out, uint32_t out_cap, uint32_t *used)
+{
+    uint32_t start = enc->hist_len;
+    uint32_t end;
+    uint32_t p;
+    uint32_t o = LZ_FRAME_HDR_LEN;
+    uint32_t ctrl = 0;
+    uint32_t nbits = 8;
+    uint8_t flags = LZ_FRAME_MAGIC;
+
+    if (raw_len > LZ_CHUNK_MAX) {
+        raw_len = LZ_CHUNK_MAX;
+    }
+    memcpy(enc->buf + start, raw, raw_len);
+    end = start + raw_len;
+
+    for (p = start; p < end;) {
+        uint32_t remain = end - p;
+        uint32_t best_len = 0;
+        int32_t q = -1;
+
+        /* 最坏情况需要 1 个新控制字节 + 2 字节匹配 */
+        if (o + (nbits == 8 ? 1 : 0) + 2 > out_cap) {
+            break;
+        }
+        if (nbits == 8) {
+            ctrl = o++;
+            out[ctrl] = 0;
+            nbits = 0;
+        }
+
+        if (remain >= LZ_MIN_MATCH) {
+            q = lz_insert(enc, p);
+        }
+        if (q >= 0) {
+            uint32_t max = remain < LZ_MAX_MATCH ? remain : LZ_MAX_MATCH;
+
+            /* 允许重叠 (q + n 可以超过 p)，解码端逐字节拷贝即可还原 */
+            while (best_len < max && enc->buf[q + best_len] == enc->buf[p + best_len]) {
+                best_len++;
+            }
+        }
+
+        if (best_len >= LZ_MIN_MATCH) {
+            uint32_t d = p - (uint32_t)q - 1;
+
+            out[o++] = d & 0xFF;
+            out[o++] = (uint8_t)((d >> 8) | ((best_len - LZ_MIN_MATCH) << 2));
+
+            /* 匹配覆盖的其他位置也要进哈希表 */
+            for (uint32_t i = 1; i < best_len && p + i + LZ_MIN_MATCH <= end; i++) {
+                lz_insert(enc, p + i);
+            }
+            p += best_len;
+        } else {
+            out[ctrl] |= 1U << nbits;
+            out[o++] = enc->buf[p++];
+        }
+        nbits++;
+    }
+
+    *used = p - start;
+
+    if (o - LZ_FRAME_HDR_LEN >= *used) {
+        /* 没有压缩收益 (随机/已压缩数据)：原样存储，能装多少装多少 */
+        uint32_t n = out_cap - LZ_FRAME_HDR_LEN;
+
+        *used = raw_len < n ? raw_len : n;
+        memcpy(out + LZ_FRAME_HDR_LEN, raw, *used);
+        o = LZ_FRAME_HDR_LEN + *used;
+    } else {
+        flags |= LZ_FRAME_LZ;
+    }
+
+    if (enc->reset) {
+        flags |= LZ_FRAME_RESET;
+        enc->reset = false;
+    }
+    out[0] = flags;
+    out[1] = *used & 0xFF;
+    out[2] = *used >> 8;
+
+    lz_commit(enc, *used);
+    return o;
+}
+
+void lz_decoder_init(struct lz_decoder *dec)
+{
+    dec->pos = 0;
+}
+
+static inline void lz_emit(struct lz_decoder *dec, uint8_t b, uint8_t *out, uint32_t *n)
+{
+    dec->window[dec->pos++ & LZ_WINDOW_MASK] = b;
+    out[(*n)++] = b;
+}
+
+int lz_decode_frame(struct lz_decoder *dec, const uint8_t *frame, uint32_t len,
+                    uint8_t *out, uint32_t out_cap)
+{
+    uint32_t raw_len;
+    uint32_t i = LZ_FRAME_HDR_LEN;
+    uint32_t n = 0;
+
+    if (len < LZ_FRAME_HDR_LEN || (frame[0] & 0xF0) != LZ_FRAME_MAGIC) {
+        return -EINVAL;
+    }
+    raw_len = frame[1] | (frame[2] << 8);
+    if (raw_len > out_cap) {
+        return -ENOMEM;
+    }
+    if (frame[0] & LZ_FRAME_RESET) {
+        dec->pos = 0;
+    }
+
+    if (!(frame[0] & LZ_FRAME_LZ)) {
+        if (len - LZ_FRAME_HDR_LEN != raw_len) {
+            return -EINVAL;
+        }
+        while (n < raw_len) {
+            lz_emit(dec, frame[i++], out, &n);
+        }
+        return n;
+    }
+
+    while (n < raw_len) {
+        uint8_t ctrl;
+
+        if (i >= len) {
+            return -EINVAL;
+        }
+        ctrl = frame[i++];
+
+        for (int bit = 0; bit < 8 && n < raw_len; bit++) {
+            if (ctrl & (1U << bit)) {
+                if (i >= len) {
+                    return -EINVAL;
+                }
+                lz_emit(dec, frame[i++], out, &n);
+            } else {
+                uint32_t dist;
+                uint32_t mlen;
+
+                if (i + 2 > len) {
+                    return -EINVAL;
+                }
+                dist = (frame[i] | ((frame[i + 1] & 0x03) << 8)) + 1;
+                mlen = (frame[i + 1] >> 2) + LZ_MIN_MATCH;
+                i += 2;
+
+                if (dist > dec->pos || n + mlen > raw_len) {
+                    return -EINVAL;
+                }
+                while (mlen--) {
+                    lz_emit(dec, dec->window[(dec->pos - dist) & LZ_WINDOW_MASK], out, &n);
+                }
+            }
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,93 @@
+/*
+ * Module: LZ Stream Codec
+ * Description: 透传数据的流式压缩 (LZSS，固定 1 KB 历史窗口)
+ *
+ * 编码器和解码器都只依赖 C 标准库，外设 (编码) 和测试主机 (解码) 共用同一份代码。
+ * 历史窗口跨帧保留，所以同一连接上的帧必须按顺序、不丢失地送达
+ * (NUS 通知和 L2CAP 通道都满足)，每次连接建立后的第一帧带 RESET 标志。
+ *
+ * 帧格式：
+ *   +--------+-----------------+--------------------+
+ *   | flags  | raw_len (LE 16) | payload            |
+ *   +--------+-----------------+--------------------+
+ *   flags:   高 4 位固定 0xC (魔数)，bit1 = RESET (清空历史)，bit0 = LZ (0 表示原样存储)
+ *   raw_len: 该帧解压后的字节数 (不超过 LZ_CHUNK_MAX)
+ *
+ * LZ payload 由若干组组成，每组 1 个控制字节 + 8 个条目，控制位从低位开始：
+ *   1 = 字面量，1 字节
+ *   0 = 匹配，2 字节：b0 = (dist-1) 低 8 位，b1 = (dist-1) 高 2 位 | (len-3) << 2
+ */
+
+#ifndef LZ_CODEC_H_
+#define LZ_CODEC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LZ_WINDOW_BITS   10
+#define LZ_WINDOW_SIZE   (1U << LZ_WINDOW_BITS)   // 历史窗口 (最远匹配距离)
+#define LZ_MIN_MATCH     3
+#define LZ_MAX_MATCH     (LZ_MIN_MATCH + 63)      // 6 位长度
+#define LZ_HASH_BITS     8
+#define LZ_CHUNK_MAX     1024                     // 每帧最多包含的原始字节数
+
+#define LZ_FRAME_HDR_LEN 3
+#define LZ_FRAME_MAGIC   0xC0
+#define LZ_FRAME_LZ      0x01
+#define LZ_FRAME_RESET   0x02
+
+/** @brief 编码器状态 (每个连接一个，约 3 KB) */
+struct lz_encoder {
+    /* 前 hist_len 字节是历史窗口，后面接着本帧的输入 */
+    uint8_t buf[LZ_WINDOW_SIZE + LZ_CHUNK_MAX];
+    uint32_t hist_len;
+    /* buf[0] 在整个数据流中的绝对位置 */
+    uint32_t base;
+    /* 3 字节哈希 → 最近一次出现的绝对位置 + 1 (0 表示空) */
+    uint32_t head[1U << LZ_HASH_BITS];
+    /* 下一帧带 RESET 标志 */
+    bool reset;
+};
+
+/** @brief 解码器状态 */
+struct lz_decoder {
+    uint8_t window[LZ_WINDOW_SIZE];
+    uint32_t pos;   // 已输出的总字节数
+};
+
+/**
+ * @brief 初始化 (或复位) 编码器，下一帧会通知对端清空历史
+ */
+void lz_encoder_init(struct lz_encoder *enc);
+
+/**
+ * @brief 把一段原始数据编码成一帧
+ *
+ * 输出帧不超过 out_cap 字节；压缩没有收益时自动改为原样存储。
+ * 编码后的原始字节立即计入历史窗口，调用者必须保证该帧最终会被发出。
+ *
+ * @param raw      原始数据
+ * @param raw_len  原始数据长度 (超过 LZ_CHUNK_MAX 的部分不处理)
+ * @param out      输出缓冲区
+ * @param out_cap  输出缓冲区大小 (至少 LZ_FRAME_HDR_LEN + 3)
+ * @param used     返回本帧实际消耗的原始字节数
+ * @return 帧长度
+ */
+uint32_t lz_encode_frame(struct lz_encoder *enc, const uint8_t *raw, uint32_t raw_len,
+                         uint8_t *out, uint32_t out_cap, uint32_t *used);
+
+/**
+ * @brief 初始化解码器
+ */
+void lz_decoder_init(struct lz_decoder *dec);
+
+/**
+ * @brief 解码一帧
+ * @param out     输出缓冲区
+ * @param out_cap 输出缓冲区大小 (LZ_CHUNK_MAX 即可容纳任何帧)
+ * @return 解压后的字节数, 负数 帧格式错误
+ */
+int lz_decode_frame(struct lz_decoder *dec, const uint8_t *frame, uint32_t len,
+                    uint8_t *out, uint32_t out_cap);
+
+#endif /* LZ_CODEC_H_ */
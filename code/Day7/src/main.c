@@ -17,13 +17,91 @@
 #include <zephyr/logging/log.h>
 
 #include "nus.h"
+#include "nus_test.h"
+#include "l2cap_bridge.h"
+#include "link_opt.h"
+#include "lz_codec.h"
+#include "mux.h"
+#include "latency.h"
+#include "spool.h"
+#include "phy_mgr.h"
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_ERR);
 
 /* ----------------配置部分---------------- */
-#define UART_BUF_SIZE     8192   // UART 接收环形缓冲区大小
+#define UART_BUF_SIZE     CONFIG_APP_BRIDGE_UART_BUF_SIZE // UART 接收环形缓冲区大小 (Kconfig，默认 8192)
 #define BLE_MTU_MAX       247    // 期望的 MTU 大小 (需要在 prj.conf 中同时也配置)
-#define WORK_RETRY_DELAY  K_MSEC(10) // 如果 BLE 缓冲区满，多久后重试
+#define WORK_RETRY_DELAY  K_MSEC(10) // 兜底重试：协议栈 Buffer 被其他流量占满且本模块没有在途通知时使用
+
+/*
+ * 异步 (DMA) 接收模式参数，仅在 CONFIG_UART_ASYNC_API=y 时生效
+ * UART_RX_DMA_BLOCK:  每次交给 UARTE DMA 的 RingBuffer 区域大小 (双缓冲，同时最多占用 2 块)
+ * UART_RX_TIMEOUT_US: RX 线路空闲超时，超过该时间没有新字节就把已收到的数据提交给消费者
+ */
+#define UART_RX_DMA_BLOCK   256
+#define UART_RX_TIMEOUT_US  100
+
+/*
+ * 有线侧硬件流控 (RTS/CTS，见 overlay 中的 hw-flow-control)
+ * uart_ring_buf 超过高水位时暂停 UART 接收，UARTE 硬件随即撤销 RTS，PC 停止发送；
+ * 发送任务把数据消耗到低水位以下后恢复接收，RTS 重新有效。
+ * 高水位之上要留出两块 DMA 区域 (暂停前已经交给 DMA 的区域仍会被写满)。
+ */
+#define UART_RX_HIGH_WATERMARK  (UART_BUF_SIZE - 2 * UART_RX_DMA_BLOCK)
+#define UART_RX_LOW_WATERMARK   (UART_BUF_SIZE / 2)
+
+/*
+ * 打包 (Coalescing) 参数
+ * 只发送填满 mtu - 3 (或一个 L2CAP SDU) 的整包，不足一包的尾巴最多等待 TX_COALESCE_BUDGET_MS，
+ * 或者在 UART 线路空闲 (异步模式下 RX 超时) 时立即发出。
+ * 设为 0 则关闭打包，有多少发多少 (旧行为)。
+ */
+#define TX_COALESCE_BUDGET_MS  5
+
+/* Flash 缓存回放时每次从 Flash 读出的字节数 (CONFIG_APP_BRIDGE_SPOOL) */
+#define SPOOL_READ_CHUNK  256
+
+/*
+ * 下行 (BLE → UART) 参数
+ * 手机写入的数据先放进 uart_tx_ring_buf，再由 UART TX (异步模式下为 DMA) 在后台发出，
+ * 蓝牙 RX 线程不再被 uart_poll_out 阻塞。
+ * 缓冲区超过高水位时通知手机暂停写入 (XOFF)，低于低水位时恢复 (XON)；
+ * 高水位之上要留出余量，容纳 XOFF 送达之前手机已经发出的若干包。
+ */
+#define UART_TX_BUF_SIZE        4096
+#define UART_TX_DMA_BLOCK       256
+#define UART_TX_HIGH_WATERMARK  (UART_TX_BUF_SIZE * 3 / 4)
+#define UART_TX_LOW_WATERMARK   (UART_TX_BUF_SIZE / 4)
+
+/*
+ * 多连接参数 (CONFIG_BT_MAX_CONN > 1 时可同时连接多个手机/上位机)
+ * UART 数据先从 uart_ring_buf 分发到每个已订阅连接自己的发送队列，
+ * 再由 DRR (Deficit Round Robin) 调度器轮流发送：每轮给每个有数据的连接 DRR_QUANTUM 字节额度，
+ * 大包 (L2CAP SDU) 攒够额度再发，所以不论包大小，各连接分到的字节数是公平的。
+ * 只有某个连接的发送队列满了才会拖住分发 (进而触发 RTS)，快连接不用等慢连接的每一包。
+ */
+#define CONN_TX_QUEUE_SIZE  2048
+#define DRR_QUANTUM         (BLE_MTU_MAX - 3)
+
+/*
+ * 发送任务 (消费者) 的运行位置
+ * CONFIG_APP_BRIDGE_TX_THREAD=y 时运行在独立的协作式线程里 (优先级 CONFIG_APP_BRIDGE_TX_THREAD_PRIO)，
+ * 阻塞在 k_poll 信号上，由 UART 中断、sent 回调直接唤醒，不用排在系统工作队列的其他工作项
+ * (日志、设置、电量服务等) 后面；否则运行在系统工作队列上。
+ */
+#define BLE_TX_THREAD_STACK_SIZE  2048
+
+/* 一包 (通知或 L2CAP SDU) 的最大长度 */
+#if defined(CONFIG_APP_BRIDGE_L2CAP)
+#define TX_PKT_MAX  MAX(BLE_MTU_MAX - 3, L2CAP_BRIDGE_SDU_LEN)
+#else
+#define TX_PKT_MAX  (BLE_MTU_MAX - 3)
+#endif
+
+/* 压缩和多通道组帧都要先把一包组好再发 (数据已经从队列取出，发送失败时原样重发) */
+#if defined(CONFIG_APP_BRIDGE_COMPRESS) || defined(CONFIG_APP_BRIDGE_MUX)
+#define TX_PKT_STAGED  1
+#endif
 
 /* ----------------硬件定义---------------- */
 /* 获取 Overlay 中定义的别名 */
@@ -38,16 +116,156 @@ static const struct device *uart_dev = DEVICE_DT_GET(DT_NODELABEL(uart0));
 /* 定义环形缓冲区 */
 RING_BUF_DECLARE(uart_ring_buf, UART_BUF_SIZE);
 
-/* 定义处理 BLE 发送的工作项 (Delayed Work 用于重试机制) */
+/*
+ * 发送任务的唤醒方式 (由 UART 接收和通知发送完成事件驱动)
+ * 线程模式：k_poll 信号立即唤醒，定时器负责延迟唤醒 (打包预算、兜底重试)
+ * 工作队列模式：一个 k_work_delayable 同时承担两者
+ */
+#if defined(CONFIG_APP_BRIDGE_TX_THREAD)
+static void ble_tx_timer_expiry(struct k_timer *timer);
+
+static struct k_poll_signal ble_tx_signal = K_POLL_SIGNAL_INITIALIZER(ble_tx_signal);
+K_TIMER_DEFINE(ble_tx_timer, ble_tx_timer_expiry, NULL);
+#else
 static struct k_work_delayable ble_tx_work;
+#endif
 
-/* 当前 BLE 连接句柄 */
-static struct bt_conn *current_conn;
-static uint16_t current_mtu = 23; // 默认 MTU，连接后会更新
+/* 唤醒延迟统计：第一次唤醒请求的时刻 (0 表示没有待处理的请求) 到发送任务真正开始运行 */
+static atomic_t tx_wake_cyc;
+static uint32_t tx_wake_count;
+static uint64_t tx_wake_sum_us;
+static uint32_t tx_wake_max_us;
+static uint32_t tx_wake_report_ms;
+
+/* 每个连接的上下文 (按 bt_conn_index 索引) */
+struct bridge_conn {
+    struct bt_conn *conn;       /* NULL 表示该槽位空闲 */
+    uint16_t mtu;               /* 默认 23，链路优化完成后更新 */
+
+    /* 该连接待发送的上行数据 */
+    struct ring_buf tx_queue;
+    uint8_t tx_queue_buf[CONN_TX_QUEUE_SIZE];
+
+    /* 打包状态：队列中最早一个字节到达的时间、尾巴立即发出 (线路空闲) */
+    uint32_t oldest_ms;
+    bool flush;
+
+    /* DRR 赤字计数：本轮还可以发送的字节数 */
+    int32_t deficit;
+
+    /* 队首字节的序号 (从 uart_ring_buf 取出的累计字节数)，用于延迟统计 */
+    uint32_t lat_seq;
+
+#if defined(CONFIG_APP_BRIDGE_COMPRESS)
+    /* 压缩状态：历史窗口跨帧保留 */
+    struct lz_encoder lz;
+    uint32_t stat_raw;      /* 压缩前的总字节数 */
+#endif
+
+#if defined(TX_PKT_STAGED)
+    /* 已经组好 (压缩帧或多通道帧)、还没发出去的一包 */
+    uint8_t frame[TX_PKT_MAX];
+    uint32_t frame_len;
+    uint32_t frame_raw;     /* 该包包含的原始 (UART) 字节数 */
+    uint32_t frame_seq;     /* 其中第一个原始字节的序号 */
+#endif
+
+    /* 打包效果统计：包数、字节数、不满一包被冲刷出去的包数 */
+    uint32_t stat_pkts;
+    uint32_t stat_bytes;
+    uint32_t stat_partial;
+};
+
+static struct bridge_conn bridge_conns[CONFIG_BT_MAX_CONN];
+
+/* DRR 每次调度从哪个连接开始 (轮换，避免总是 0 号连接先发) */
+static uint8_t drr_next;
+
+/* UART 侧打包状态：最早一个未分发字节到达的时间、立即冲刷标志 (线路空闲) */
+static atomic_t tx_oldest_ms;
+static atomic_t tx_flush;
+
+/* 攒够多少字节就立即唤醒消费者 (所有已订阅连接中最小的整包负载) */
+static atomic_t tx_kick_len = ATOMIC_INIT(BLE_MTU_MAX - 3);
+
+/* 跨越 RingBuffer 回绕点时，用来拼成一个整包的线性缓冲区 (压缩时一次最多取 LZ_CHUNK_MAX 原始字节) */
+#if defined(CONFIG_APP_BRIDGE_COMPRESS)
+static uint8_t tx_pkt_buf[MAX(TX_PKT_MAX, LZ_CHUNK_MAX)];
+#else
+static uint8_t tx_pkt_buf[TX_PKT_MAX];
+#endif
+
+/* RingBuffer 到达高水位时 RX 会停下来 (RTS 撤销)，等消费者降到低水位后再重新开启 */
+static atomic_t rx_paused;
+
+/* 上行 UART 接收统计：字节数、丢弃字节数、硬件溢出次数、RTS 暂停次数 */
+static uint32_t rx_stat_bytes;
+static uint32_t rx_stat_dropped;
+static uint32_t rx_stat_overrun;
+static uint32_t rx_stat_pauses;
+
+/* 下行缓冲区 (BLE → UART) 及流控状态 */
+RING_BUF_DECLARE(uart_tx_ring_buf, UART_TX_BUF_SIZE);
+static atomic_t downlink_xoff;
+static struct k_work downlink_flow_work;
+
+/* 下行统计：接收字节数、因缓冲区满被拒绝的字节数、XOFF 次数 */
+static uint32_t downlink_stat_bytes;
+static uint32_t downlink_stat_refused;
+static uint32_t downlink_stat_xoff;
+
+BUILD_ASSERT(UART_RX_LOW_WATERMARK < UART_RX_HIGH_WATERMARK, "低水位必须小于高水位");
+
+#if defined(CONFIG_UART_ASYNC_API)
+BUILD_ASSERT(UART_RX_DMA_BLOCK * 2 <= UART_BUF_SIZE, "RingBuffer 至少要容纳两块 DMA 区域");
+
+/* DMA 正在写入、但还没有提交 (put_finish) 的 RingBuffer 字节数 */
+static uint32_t rx_claimed;
+/* 当前正在接收的 DMA 块和已准备好的下一块的长度，用于区分“写满”和“空闲超时” */
+static uint32_t rx_cur_len;
+static uint32_t rx_next_len;
+/* UART TX DMA 正在发送 (同一时间只允许一个消费者 Claim 下行缓冲区) */
+static atomic_t uart_tx_busy;
+#endif
 
 /* ----------------函数声明---------------- */
+#if defined(CONFIG_UART_ASYNC_API)
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data);
+static int uart_rx_start(void);
+#else
 static void uart_cb(const struct device *dev, void *user_data);
-static void ble_tx_work_handler(struct k_work *work);
+#endif
+
+static struct bridge_conn *bridge_conn_get(struct bt_conn *conn)
+{
+    return &bridge_conns[bt_conn_index(conn)];
+}
+
+/* 立即唤醒发送任务 (可在中断中调用) */
+static void ble_tx_wake(void)
+{
+    /* 只记录第一次请求；| 1 保证时间戳不为 0 */
+    atomic_cas(&tx_wake_cyc, 0, (atomic_val_t)(k_cycle_get_32() | 1));
+
+#if defined(CONFIG_APP_BRIDGE_TX_THREAD)
+    k_poll_signal_raise(&ble_tx_signal, 0);
+#else
+    k_work_reschedule(&ble_tx_work, K_NO_WAIT);
+#endif
+}
+
+/* delay 之后唤醒发送任务；已经安排了唤醒时保持原来的时间 (与 k_work_schedule 相同) */
+static void ble_tx_wake_after(k_timeout_t delay)
+{
+#if defined(CONFIG_APP_BRIDGE_TX_THREAD)
+    if (k_timer_remaining_ticks(&ble_tx_timer) == 0) {
+        k_timer_start(&ble_tx_timer, delay, K_NO_WAIT);
+    }
+#else
+    k_work_schedule(&ble_tx_work, delay);
+#endif
+}
+
 /* 连接参数更新回调 */
 static void le_param_updated(struct bt_conn *conn, uint16_t interval,
                               uint16_t latency, uint16_t timeout)
@@ -55,27 +273,359 @@ static void le_param_updated(struct bt_conn *conn, uint16_t interval,
     LOG_INF("Connection params updated: interval=%d, latency=%d, timeout=%d",
             interval, latency, timeout);
 }
-/* MTU 交换完成后的回调 */
-static void exchange_func(struct bt_conn *conn, uint8_t att_err,
-                          struct bt_gatt_exchange_params *params)
+/* 该连接一个通知 (或 L2CAP SDU) 能承载的最大负载 */
+static uint32_t tx_payload_len(struct bridge_conn *ctx)
 {
-    if (!att_err) {
-        /* 更新全局变量，RingBuffer 消费者将立即开始打包更多数据 */
-        current_mtu = bt_gatt_get_mtu(conn);
-        LOG_INF("MTU exchange successful, new MTU: %d", current_mtu);
+    if (l2cap_bridge_is_connected(ctx->conn)) {
+        return MIN(l2cap_bridge_payload_len(ctx->conn), TX_PKT_MAX);
+    }
+    return MIN(ctx->mtu, BLE_MTU_MAX) - MY_NUS_NTF_OVERHEAD;
+}
+
+/* 该连接的对端是否要接收上行数据 (订阅了 NUS 通知或打开了 L2CAP 通道) */
+static bool bridge_conn_subscribed(struct bridge_conn *ctx)
+{
+    return ctx->conn &&
+           (l2cap_bridge_is_connected(ctx->conn) || my_nus_is_subscribed(ctx->conn));
+}
+
+/* 该连接是否开始接收上行数据：已订阅，并且链路优化 (MTU/DLE/PHY/连接参数) 已经完成 */
+static bool bridge_conn_active(struct bridge_conn *ctx)
+{
+    return bridge_conn_subscribed(ctx) && link_opt_is_ready(ctx->conn);
+}
+
+#if defined(CONFIG_APP_BRIDGE_TX_THREAD)
+/*
+ * 发送线程不在系统工作队列上，bt_gatt_notify_cb 拿不到 Buffer 时会一直等，
+ * 一个慢连接就会卡住所有连接的发送。每个连接的通知窗口已经小于 Buffer 总数，
+ * 但 L2CAP 通道的分段 (系统工作队列上发出) 也占同一批 ACL Buffer，
+ * 所以提交通知前按所有连接的在途总量再检查一次，占满了就按窗口已满处理。
+ */
+static bool bridge_tx_bufs_available(void)
+{
+    uint32_t used = 0;
+
+    for (int i = 0; i < CONFIG_BT_MAX_CONN; i++) {
+        struct bridge_conn *ctx = &bridge_conns[i];
+
+        if (ctx->conn) {
+            used += my_nus_tx_in_flight(ctx->conn) +
+                    l2cap_bridge_tx_in_flight(ctx->conn) * L2CAP_BRIDGE_SDU_SEGS;
+        }
+    }
+    return used < MY_NUS_TX_WINDOW * CONFIG_BT_MAX_CONN;
+}
+#endif
+
+/*
+ * 发送一包透传数据
+ * 对端打开了 L2CAP 通道就走 L2CAP (由信用控制节奏)，否则走 NUS 通知。
+ */
+static int bridge_send(struct bridge_conn *ctx, const uint8_t *data, uint32_t len)
+{
+    uint32_t start;
+    int err;
+
+    if (l2cap_bridge_is_connected(ctx->conn)) {
+        return l2cap_bridge_send(ctx->conn, data, len);
+    }
+
+#if defined(CONFIG_APP_BRIDGE_TX_THREAD)
+    /* 等任意连接的 sent 回调腾出 Buffer 后再唤醒 */
+    if (!bridge_tx_bufs_available()) {
+        return -EAGAIN;
+    }
+#endif
+
+    /* 只统计真正交给协议栈的通知 (窗口已满的 -EAGAIN 不算) */
+    start = k_cycle_get_32();
+    err = my_nus_send(ctx->conn, data, len);
+    if (err == 0) {
+        nus_test_record_notify_cycles(k_cycle_get_32() - start);
+    }
+    return err;
+}
+
+/* 该连接在当前传输方式下已提交、尚未完成的包数 */
+static uint32_t bridge_tx_in_flight(struct bridge_conn *ctx)
+{
+    return my_nus_tx_in_flight(ctx->conn) + l2cap_bridge_tx_in_flight(ctx->conn);
+}
+
+/*
+ * 生产者写入 RingBuffer 后调用 (ISR 上下文)
+ * 攒够一整包立即唤醒消费者；否则只在第一次进数据时启动延迟预算定时器，
+ * 后续数据不会推迟已经启动的定时器 (k_work_schedule 对已排队的工作无效)。
+ */
+static void ble_tx_kick(bool was_empty)
+{
+    if (was_empty) {
+        atomic_set(&tx_oldest_ms, k_uptime_get_32());
+    }
+
+    if (TX_COALESCE_BUDGET_MS == 0 || atomic_get(&tx_flush) ||
+        ring_buf_size_get(&uart_ring_buf) >= (uint32_t)atomic_get(&tx_kick_len)) {
+        ble_tx_wake();
     } else {
-        LOG_ERR("MTU exchange failed (err %d)", att_err);
+        ble_tx_wake_after(K_MSEC(TX_COALESCE_BUDGET_MS));
     }
 }
+/* ============================================================
+ *  下行逻辑 (BLE → UART)
+ * ============================================================ */
+
+/* 发送 XON/XOFF 通知 (水位变化可能发生在 UART 中断里，而 GATT API 不能在中断中调用) */
+static void downlink_flow_work_handler(struct k_work *work)
+{
+    bool xoff = atomic_get(&downlink_xoff);
+
+    /* 下行缓冲区所有连接共用，XON/XOFF 通知给所有订阅了 Flow 的连接 */
+    my_nus_set_flow(NULL, xoff);
+
+    /* L2CAP 通道不看 XON/XOFF，而是靠扣住信用：恢复时投递暂存的 SDU 并归还信用 */
+    if (!xoff) {
+        l2cap_bridge_rx_resume();
+    }
+}
+
+/* UART 取走数据后检查低水位，满足条件则允许手机继续写入 */
+static void downlink_check_low_watermark(void)
+{
+    if (ring_buf_size_get(&uart_tx_ring_buf) <= UART_TX_LOW_WATERMARK &&
+        atomic_cas(&downlink_xoff, 1, 0)) {
+        k_work_submit(&downlink_flow_work);
+    }
+}
+
+#if defined(CONFIG_UART_ASYNC_API)
+
+/* 如果 UART TX 空闲，从下行缓冲区 Claim 一段连续数据交给 DMA 发送 */
+static void uart_tx_kick(void)
+{
+    uint8_t *data;
+    uint32_t len;
+
+    while (atomic_cas(&uart_tx_busy, 0, 1)) {
+        len = ring_buf_get_claim(&uart_tx_ring_buf, &data, UART_TX_DMA_BLOCK);
+        if (len) {
+            if (uart_tx(uart_dev, data, len, SYS_FOREVER_US) == 0) {
+                return;
+            }
+            LOG_ERR("uart_tx failed");
+            ring_buf_get_finish(&uart_tx_ring_buf, 0);
+            atomic_clear(&uart_tx_busy);
+            return;
+        }
+
+        ring_buf_get_finish(&uart_tx_ring_buf, 0);
+        atomic_clear(&uart_tx_busy);
+
+        /* 清除忙标志前生产者可能刚放入数据 (它的 kick 因为忙直接返回了)，再检查一次 */
+        if (ring_buf_is_empty(&uart_tx_ring_buf)) {
+            return;
+        }
+    }
+}
+
+/* 一段 DMA 发送结束 (完成或中止)，消费已发出的字节并继续发送下一段 */
+static void uart_tx_done(uint32_t len)
+{
+    ring_buf_get_finish(&uart_tx_ring_buf, len);
+    atomic_clear(&uart_tx_busy);
+    downlink_check_low_watermark();
+    uart_tx_kick();
+}
+
+#else /* !CONFIG_UART_ASYNC_API */
+
+/* 中断模式：打开 TX 中断，由 uart_cb 在 TX FIFO 空闲时填充数据 */
+static void uart_tx_kick(void)
+{
+    uart_irq_tx_enable(uart_dev);
+}
+
+#endif /* CONFIG_UART_ASYNC_API */
 
-/* 定义 MTU 交换参数结构体 */
-static struct bt_gatt_exchange_params exchange_params = {
-    .func = exchange_func,
-};
 /* ============================================================
  *  UART 处理逻辑 (生产者)
  * ============================================================ */
 
+#if defined(CONFIG_UART_ASYNC_API)
+
+/*
+ * 从 RingBuffer 中直接 Claim 一块连续区域作为 DMA 接收缓冲区
+ * 数据由 UARTE 直接写入 RingBuffer，省掉一次 memcpy，也没有逐字节中断
+ */
+static uint8_t *uart_rx_claim(uint32_t *len)
+{
+    uint8_t *buf;
+
+    *len = ring_buf_put_claim(&uart_ring_buf, &buf, UART_RX_DMA_BLOCK);
+    if (*len == 0) {
+        return NULL;
+    }
+    rx_claimed += *len;
+    return buf;
+}
+
+/*
+ * 提交 DMA 已经写好的 len 字节
+ *
+ * 注意：ring_buf_put_finish 会把 put_head 拉回到提交位置，
+ * 相当于把另一块仍在 DMA 手里的区域也一起“退还”了。
+ * 所以提交后要按原顺序重新 Claim 回剩余部分 (可能跨越回绕点，需要循环)。
+ */
+static void uart_rx_commit(uint32_t len)
+{
+    uint32_t pending = rx_claimed - len;
+    uint8_t *buf;
+
+    ring_buf_put_finish(&uart_ring_buf, len);
+    rx_claimed = 0;
+    latency_ingress(len);
+
+    while (rx_claimed < pending) {
+        uint32_t n = ring_buf_put_claim(&uart_ring_buf, &buf, pending - rx_claimed);
+
+        if (n == 0) {
+            break;
+        }
+        rx_claimed += n;
+    }
+}
+
+/* 开启 DMA 接收，RingBuffer 没有空间时返回 -ENOMEM (保持暂停，RTS 撤销) */
+static int uart_rx_start(void)
+{
+    uint8_t *buf;
+    uint32_t len;
+    int err;
+
+    buf = uart_rx_claim(&len);
+    if (!buf) {
+        atomic_set(&rx_paused, 1);
+        rx_stat_pauses++;
+        return -ENOMEM;
+    }
+
+    rx_cur_len = len;
+    rx_next_len = 0;
+    err = uart_rx_enable(uart_dev, buf, len, UART_RX_TIMEOUT_US);
+    if (err) {
+        LOG_ERR("uart_rx_enable failed (err %d)", err);
+        ring_buf_put_finish(&uart_ring_buf, 0);
+        rx_claimed = 0;
+    }
+    return err;
+}
+
+/* UART 初始化 (异步 DMA 模式) */
+static int uart_init(void)
+{
+    int err;
+
+    if (!device_is_ready(uart_dev)) {
+        LOG_ERR("UART device not ready");
+        return -1;
+    }
+
+    LOG_INF("UART device: %s", uart_dev->name);
+
+    err = uart_callback_set(uart_dev, uart_cb, NULL);
+    if (err) {
+        LOG_ERR("uart_callback_set failed (err %d)", err);
+        return err;
+    }
+
+    err = uart_rx_start();
+    if (err) {
+        return err;
+    }
+
+    LOG_INF("UART initialized in async (DMA) RX mode");
+
+    return 0;
+}
+
+/* UART 异步事件回调 (运行在 UARTE 中断上下文) */
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    uint8_t *buf;
+    uint32_t len;
+
+    switch (evt->type) {
+    case UART_RX_BUF_REQUEST:
+        /*
+         * 双缓冲：当前块正在接收时，提前准备好下一块
+         * 超过高水位则不提供下一块：当前块写满后 RX 自动停止，UARTE 撤销 RTS
+         */
+        buf = NULL;
+        if (ring_buf_size_get(&uart_ring_buf) < UART_RX_HIGH_WATERMARK) {
+            buf = uart_rx_claim(&len);
+        }
+        if (buf) {
+            rx_next_len = len;
+            uart_rx_buf_rsp(dev, buf, len);
+        } else {
+            LOG_DBG("RingBuffer high watermark, RX pausing");
+        }
+        break;
+
+    case UART_RX_RDY: {
+        /* DMA 写满一块或者线路空闲超时，把这部分数据交给消费者 */
+        bool was_empty = ring_buf_is_empty(&uart_ring_buf);
+
+        uart_rx_commit(evt->data.rx.len);
+        rx_stat_bytes += evt->data.rx.len;
+
+        /* 没有写到块尾就上报，说明是 RX 空闲超时：对端暂时不发了，尾巴不用再等 */
+        if (evt->data.rx.offset + evt->data.rx.len < rx_cur_len) {
+            atomic_set(&tx_flush, 1);
+        }
+        ble_tx_kick(was_empty);
+        gpio_pin_toggle_dt(&led_act);
+        break;
+    }
+
+    case UART_RX_BUF_RELEASED:
+        rx_cur_len = rx_next_len;
+        rx_next_len = 0;
+        break;
+
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        uart_tx_done(evt->data.tx.len);
+        break;
+
+    case UART_RX_STOPPED:
+        LOG_WRN("UART RX stopped (reason %d)", evt->data.rx_stop.reason);
+        if (evt->data.rx_stop.reason & UART_ERROR_OVERRUN) {
+            rx_stat_overrun++;
+        }
+        break;
+
+    case UART_RX_DISABLED:
+        /* 退还所有未写入的 Claim 区域 */
+        ring_buf_put_finish(&uart_ring_buf, 0);
+        rx_claimed = 0;
+
+        /* 因高水位停下的保持暂停，由消费者降到低水位后恢复；其他原因 (错误) 立即重启 */
+        if (ring_buf_size_get(&uart_ring_buf) >= UART_RX_HIGH_WATERMARK) {
+            atomic_set(&rx_paused, 1);
+            rx_stat_pauses++;
+        } else {
+            uart_rx_start();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+#else /* !CONFIG_UART_ASYNC_API */
+
 /* UART 初始化 */
 static int uart_init(void)
 {
@@ -114,151 +664,922 @@ static void uart_cb(const struct device *dev, void *user_data)
              * 关键点：将数据放入 RingBuffer 
              * RingBuffer 是 ISR 和 WorkQueue 之间的桥梁
              */
+            bool was_empty = ring_buf_is_empty(&uart_ring_buf);
             int written = ring_buf_put(&uart_ring_buf, recv_buf, recv_len);
             
+            rx_stat_bytes += written;
+            latency_ingress(written);
             if (written < recv_len) {
+                rx_stat_dropped += recv_len - written;
                 LOG_WRN("RingBuffer Full! Dropped %d bytes", recv_len - written);
             }
 
-            /* 触发 System Work Queue 进行 BLE 发送处理 */
-            /* 使用 k_work_schedule 如果是 delayable work */
+            /* 超过高水位：停止读 FIFO，UARTE 内部 FIFO 将满时硬件撤销 RTS */
+            if (ring_buf_size_get(&uart_ring_buf) >= UART_RX_HIGH_WATERMARK) {
+                uart_irq_rx_disable(dev);
+                atomic_set(&rx_paused, 1);
+                rx_stat_pauses++;
+            }
 
-            k_work_schedule(&ble_tx_work, K_MSEC(1)); 
+            /* 触发 System Work Queue 进行 BLE 发送处理 (攒够整包才立即唤醒) */
+            ble_tx_kick(was_empty);
             
             /* 闪烁 LED 表示有 Activity */
             gpio_pin_toggle_dt(&led_act);
         }
     }
+
+    if (uart_irq_tx_ready(dev)) {
+        /* 下行：把下行缓冲区中的数据填进 TX FIFO，没有数据了就关闭 TX 中断 */
+        uint8_t *data;
+        uint32_t len = ring_buf_get_claim(&uart_tx_ring_buf, &data, UART_TX_DMA_BLOCK);
+
+        if (len) {
+            int sent = uart_fifo_fill(dev, data, len);
+
+            ring_buf_get_finish(&uart_tx_ring_buf, MAX(sent, 0));
+        } else {
+            ring_buf_get_finish(&uart_tx_ring_buf, 0);
+            uart_irq_tx_disable(dev);
+        }
+        downlink_check_low_watermark();
+    }
+}
+
+#endif /* CONFIG_UART_ASYNC_API */
+
+/* 消费者降到低水位以下：恢复 UART 接收，RTS 重新有效 */
+static void uart_rx_check_resume(void)
+{
+    if (ring_buf_size_get(&uart_ring_buf) > UART_RX_LOW_WATERMARK ||
+        !atomic_cas(&rx_paused, 1, 0)) {
+        return;
+    }
+
+#if defined(CONFIG_UART_ASYNC_API)
+    uart_rx_start();
+#else
+    uart_irq_rx_enable(uart_dev);
+#endif
 }
 
 /* ============================================================
  *  BLE 处理逻辑 (消费者)
  * ============================================================ */
 
-/* 
- * 核心任务：从 RingBuffer 取数据发给 BLE
- * 包含了流控逻辑：如果 BLE 返回忙，则不消耗 Buffer，稍后重试。
+/*
+ * 从发送队列取出 len 字节用于发送 (此时还不消费)
+ * 连续区域直接返回内部指针 (零拷贝)；跨越回绕点时拷贝到 tx_pkt_buf 拼成整包。
  */
-static void ble_tx_work_handler(struct k_work *work)
+static uint8_t *ble_tx_peek(struct ring_buf *rb, uint32_t len)
 {
     uint8_t *data_ptr;
-    uint32_t len;
-    int err;
+    uint32_t claimed;
+
+    claimed = ring_buf_get_claim(rb, &data_ptr, len);
+    ring_buf_get_finish(rb, 0);
+    if (claimed == len) {
+        return data_ptr;
+    }
+
+    ring_buf_peek(rb, tx_pkt_buf, len);
+    return tx_pkt_buf;
+}
+
+/* 打印打包效果：平均每包填充率 = 实际字节数 / (包数 * 整包负载) */
+static void ble_tx_stats_report(struct bridge_conn *ctx)
+{
+    uint32_t capacity = ctx->stat_pkts * tx_payload_len(ctx);
 
-    if (!current_conn) {
-        // 如果没有连接，丢弃缓冲区数据，防止溢出
-        ring_buf_reset(&uart_ring_buf);
+    if (capacity == 0) {
         return;
     }
+    printk("TX coalescing [conn %u]: %u pkts, %u bytes, %u partial, fill %u%%\n",
+           bt_conn_index(ctx->conn), ctx->stat_pkts, ctx->stat_bytes, ctx->stat_partial,
+           (uint32_t)((uint64_t)ctx->stat_bytes * 100 / capacity));
+#if defined(CONFIG_APP_BRIDGE_COMPRESS)
+    printk("TX compress [conn %u]: %u raw -> %u bytes, ratio %u.%02u\n",
+           bt_conn_index(ctx->conn), ctx->stat_raw, ctx->stat_bytes,
+           ctx->stat_raw / ctx->stat_bytes, ctx->stat_raw * 100 / ctx->stat_bytes % 100);
+#endif
+}
 
-    /* 循环处理，直到 Buffer 为空或 BLE 缓冲区满 */
-    while (1) {
-        /* 
-         * 1. 获取 Buffer 中的数据指针（Claim），但不立即移除(Consume)
-         *    这样如果发送失败，我们只需取消 Claim，数据还在 Buffer 中
+/* 打印上行 UART 接收统计 (开启硬件流控后 dropped/overrun 应始终为 0) */
+static void uart_rx_stats_report(void)
+{
+    printk("UART RX: %u bytes, %u dropped, %u overrun, %u rts pauses\n",
+           rx_stat_bytes, rx_stat_dropped, rx_stat_overrun, rx_stat_pauses);
+}
+
+/* 打印下行统计 */
+static void downlink_stats_report(void)
+{
+    printk("RX downlink: %u bytes, %u refused, %u xoff\n",
+           downlink_stat_bytes, downlink_stat_refused, downlink_stat_xoff);
+}
+
+/* 把一段数据放进每个接收上行数据的连接的发送队列 (调用者保证都放得下)，seq 为第一个字节的序号 */
+static void fanout_put(const uint8_t *data, uint32_t len, uint32_t seq)
+{
+    for (int i = 0; i < ARRAY_SIZE(bridge_conns); i++) {
+        struct bridge_conn *ctx = &bridge_conns[i];
+
+        if (!bridge_conn_active(ctx)) {
+            continue;
+        }
+        if (ring_buf_is_empty(&ctx->tx_queue)) {
+            ctx->oldest_ms = (uint32_t)atomic_get(&tx_oldest_ms);
+            ctx->lat_seq = seq;
+        }
+        ring_buf_put(&ctx->tx_queue, data, len);
+    }
+}
+
+#if defined(CONFIG_APP_BRIDGE_SPOOL)
+/* Flash 缓存中最老字节的序号 (延迟统计用) */
+static uint32_t spool_seq;
+
+/* 回放统计：从开始回放到缓存清空 */
+static bool spool_replaying;
+static uint32_t spool_replay_start_ms;
+static uint32_t spool_replay_bytes;
+
+/* 把 uart_ring_buf 中的数据全部追加到 Flash 缓存 */
+static void spool_uart_data(void)
+{
+    uint8_t *data;
+    uint32_t len;
+
+    while ((len = ring_buf_get_claim(&uart_ring_buf, &data, UART_BUF_SIZE)) > 0) {
+        uint32_t seq = latency_claim(len);
+
+        if (spool_is_empty()) {
+            spool_seq = seq;
+        }
+        /* 缓存满了会丢弃最老的数据，序号跟着前移 */
+        spool_seq += spool_append(data, len);
+        ring_buf_get_finish(&uart_ring_buf, len);
+    }
+}
+
+/* 从 Flash 缓存回放最多 space 字节到各连接的发送队列，返回回放的字节数 */
+static uint32_t spool_fanout(uint32_t space)
+{
+    static uint8_t buf[SPOOL_READ_CHUNK];
+    uint32_t done = 0;
+    uint32_t len;
+
+    if (!spool_replaying) {
+        spool_replaying = true;
+        spool_replay_start_ms = k_uptime_get_32();
+        spool_replay_bytes = 0;
+        printk("Spool: replaying %u bytes (fill %u%%)\n", spool_size_get(),
+               spool_size_get() * 100 / spool_capacity());
+    }
+
+    while (done < space && (len = spool_read(buf, MIN(sizeof(buf), space - done))) > 0) {
+        fanout_put(buf, len, spool_seq);
+        spool_seq += len;
+        done += len;
+    }
+    spool_replay_bytes += done;
+
+    if (spool_is_empty()) {
+        uint32_t ms = MAX(k_uptime_get_32() - spool_replay_start_ms, 1);
+
+        printk("Spool: replayed %u bytes in %u ms (%u kbps)\n", spool_replay_bytes, ms,
+               (uint32_t)((uint64_t)spool_replay_bytes * 8 / ms));
+        spool_stats_report();
+        spool_replaying = false;
+    }
+
+    return done;
+}
+#endif /* CONFIG_APP_BRIDGE_SPOOL */
+
+/*
+ * 把 uart_ring_buf 中的数据分发到每个已订阅连接的发送队列
+ * 每个连接都要拿到完整的数据流，所以一次只分发所有队列都放得下的部分。
+ * 开启 Flash 缓存时，没有连接在接收的数据存进缓存；缓存里还有积压时，
+ * 新数据排到缓存末尾，先回放积压数据，保证字节顺序。
+ * 返回分发的字节数。
+ */
+static uint32_t uart_fanout(void)
+{
+    uint32_t space = UINT32_MAX;
+    uint32_t n;
+    uint32_t done = 0;
+    bool any = false;
+    bool optimizing = false;
+    uint8_t *data;
+
+    /*
+     * 还在做链路优化的连接不参与：它们不限制其他连接的分发，
+     * link_ready 之后从当时的数据流位置开始接收 (fanout_put 只写入活动连接)
+     */
+    for (int i = 0; i < ARRAY_SIZE(bridge_conns); i++) {
+        if (bridge_conn_active(&bridge_conns[i])) {
+            space = MIN(space, ring_buf_space_get(&bridge_conns[i].tx_queue));
+            any = true;
+        } else if (bridge_conn_subscribed(&bridge_conns[i])) {
+            optimizing = true;
+        }
+    }
+
+    if (!any && optimizing) {
+        /* 只有正在优化的连接：先不分发，数据留在 uart_ring_buf (满了由 RTS 挡住 PC) */
+        return 0;
+    }
+
+    if (!any) {
+#if defined(CONFIG_APP_BRIDGE_SPOOL)
+        /* 没有任何连接在接收：存进 Flash 缓存，重新连接后回放 */
+        spool_uart_data();
+#else
+        /*
+         * 没有任何连接在接收，丢弃缓冲区数据，防止溢出
+         * 只丢弃已提交的数据 (ring_buf_reset 会破坏 DMA 正在写入的 Claim 区域)
          */
-        len = ring_buf_get_claim(&uart_ring_buf, &data_ptr, current_mtu - 3);
-        
-        if (len == 0) {
-            // Buffer 空了，退出任务
-            ring_buf_get_finish(&uart_ring_buf, 0);
-            break; 
+        latency_claim(ring_buf_get(&uart_ring_buf, NULL, ring_buf_size_get(&uart_ring_buf)));
+#endif
+        atomic_clear(&tx_flush);
+        return 0;
+    }
+
+#if defined(CONFIG_APP_BRIDGE_SPOOL)
+    /* 缓存里还有积压：新数据排到缓存末尾 (多半还在 RAM 里)，先回放积压数据 */
+    if (!spool_is_empty()) {
+        spool_uart_data();
+        return space ? spool_fanout(space) : 0;
+    }
+#endif
+
+    /* 数据可能跨越回绕点，最多分两段 */
+    n = MIN(ring_buf_size_get(&uart_ring_buf), space);
+    while (done < n) {
+        uint32_t len = ring_buf_get_claim(&uart_ring_buf, &data, n - done);
+
+        fanout_put(data, len, latency_claim(len));
+        ring_buf_get_finish(&uart_ring_buf, len);
+        done += len;
+    }
+
+    /* 队列放不下、uart_ring_buf 还剩数据：剩下的部分从现在开始计时 (同 conn_queue_restamp) */
+    if (done && !ring_buf_is_empty(&uart_ring_buf)) {
+        atomic_set(&tx_oldest_ms, k_uptime_get_32());
+    }
+
+    /* UART 线路空闲且已全部分发：各队列的尾巴不用再等 */
+    if (ring_buf_is_empty(&uart_ring_buf) && atomic_cas(&tx_flush, 1, 0)) {
+        for (int i = 0; i < ARRAY_SIZE(bridge_conns); i++) {
+            if (bridge_conn_active(&bridge_conns[i])) {
+                bridge_conns[i].flush = true;
+            }
         }
+    }
 
-        LOG_DBG("BLE TX: sending %d bytes", len);
+    return done;
+}
 
-        /* 3. 尝试通过 BLE 发送 */
-        err = my_nus_send(current_conn, data_ptr, len);
+/*
+ * 队列头部的字节已经取走：剩下的尾巴从现在开始计时
+ * oldest_ms 只在队列由空变为非空时记录，整包发出后不刷新的话，尾巴会沿用已发出字节的
+ * 到达时间，持续输入时每条尾巴都被当成超过延迟预算、立即单独发出，打包就失效了。
+ */
+static void conn_queue_restamp(struct bridge_conn *ctx)
+{
+    if (!ring_buf_is_empty(&ctx->tx_queue)) {
+        ctx->oldest_ms = k_uptime_get_32();
+    }
+}
 
-        if (err == -EAGAIN || err == -ENOMEM) {
-            /* 
-             * 重点流控逻辑：
-             * 发送失败（资源不足），说明协议栈 Buffer 满了。
-             * 1. 释放 Claim，告诉 RingBuffer 我们没消费任何数据 (size = 0)。
-             * 2. 调度延时任务，稍后再试。
-             */
-            ring_buf_get_finish(&uart_ring_buf, 0); 
-            LOG_DBG("BLE Stack Full, retrying later...");
-            k_work_schedule(&ble_tx_work, WORK_RETRY_DELAY);
-            break; // 跳出循环，让出 CPU
-        } else if (err < 0) {
-            /* 其他错误，可能是连接断开等，消费掉数据以免死循环 */
-            LOG_ERR("BLE Send Error: %d", err);
-            ring_buf_get_finish(&uart_ring_buf, len);
-        } else {
-            /* 
-             * 发送成功：
-             * 确认消费掉已发送的 len 长度
-             */
-            LOG_DBG("BLE TX: sent %d bytes successfully", len);
-            ring_buf_get_finish(&uart_ring_buf, len);
+/*
+ * 该连接下一包要发多少字节
+ * 只发整包；不足一包时，延迟预算没到、线路也没空闲就返回 0，并更新最近的等待时间。
+ */
+static uint32_t conn_next_len(struct bridge_conn *ctx, uint32_t payload, uint32_t *wait_ms)
+{
+    uint32_t avail = ring_buf_size_get(&ctx->tx_queue);
+    uint32_t waited;
+
+    if (avail >= payload) {
+        return payload;
+    }
+    if (avail == 0) {
+        ctx->flush = false;
+        return 0;
+    }
+
+    waited = k_uptime_get_32() - ctx->oldest_ms;
+    if (!ctx->flush && waited < TX_COALESCE_BUDGET_MS) {
+        *wait_ms = MIN(*wait_ms, TX_COALESCE_BUDGET_MS - waited);
+        return 0;
+    }
+    return avail;
+}
+
+/*
+ * 准备好的一包：data/len 是要发出的内容，raw 是其中包含的原始 (UART) 字节数，
+ * seq 是第一个原始字节的序号
+ */
+struct tx_pkt {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t raw;
+    uint32_t seq;
+};
+
+#if defined(CONFIG_APP_BRIDGE_MUX)
+/*
+ * 按严格优先级组一包：控制 → 控制台 (UART 数据) → 传感器
+ * 控制台数据照常按打包规则等整包；有控制/传感器消息时不等，顺带捎上控制台已有的数据。
+ * 控制消息最多排在已经组好或在途的几包后面，不会等 uart_ring_buf 里的大量数据。
+ * 返回包长 (ctx->frame_raw 为其中的控制台字节数)。
+ */
+static uint32_t mux_build_packet(struct bridge_conn *ctx, uint32_t payload, uint32_t *wait_ms)
+{
+    struct bt_conn *conn = ctx->conn;
+    uint32_t console = conn_next_len(ctx, payload - MUX_OVERHEAD, wait_ms);
+    uint32_t o;
+
+    if (mux_has_pending(conn, MUX_CH_CONTROL) || mux_has_pending(conn, MUX_CH_SENSOR)) {
+        console = ring_buf_size_get(&ctx->tx_queue);
+    } else if (console == 0) {
+        return 0;
+    }
+
+    o = mux_take(conn, MUX_CH_CONTROL, ctx->frame, payload);
+
+    ctx->frame_raw = 0;
+    if (console && o + MUX_OVERHEAD < payload) {
+        uint8_t *out = ctx->frame + o;
+
+        console = MIN(console, payload - o - MUX_OVERHEAD);
+        ring_buf_get(&ctx->tx_queue, out + MUX_HDR_LEN, console);
+        conn_queue_restamp(ctx);
+        o += mux_frame_put(out, MUX_CH_CONSOLE, out + MUX_HDR_LEN, console);
+        ctx->frame_raw = console;
+    }
+
+    o += mux_take(conn, MUX_CH_SENSOR, ctx->frame + o, payload - o);
+    return o;
+}
+#endif /* CONFIG_APP_BRIDGE_MUX */
+
+/*
+ * 准备该连接的下一包，返回包长 (0 表示暂时没有可发的)
+ * 不压缩时直接从队列 Peek (发送成功后才消费)；
+ * 压缩时把最多 LZ_CHUNK_MAX 原始字节编码成一帧存进 ctx->frame，发送失败下次原样重发；
+ * 多通道模式同样先在 ctx->frame 中组好一包。
+ */
+static uint32_t conn_next_packet(struct bridge_conn *ctx, uint32_t payload, uint32_t *wait_ms,
+                                 struct tx_pkt *pkt)
+{
+#if defined(TX_PKT_STAGED)
+    if (!ctx->frame_len) {
+#if defined(CONFIG_APP_BRIDGE_COMPRESS)
+        uint32_t raw = conn_next_len(ctx, LZ_CHUNK_MAX, wait_ms);
+
+        if (raw == 0) {
+            return 0;
+        }
+        ctx->frame_len = lz_encode_frame(&ctx->lz, ble_tx_peek(&ctx->tx_queue, raw), raw,
+                                         ctx->frame, payload, &ctx->frame_raw);
+        /* 已经编码进帧 (并计入压缩历史)，立即从队列移除 */
+        ring_buf_get(&ctx->tx_queue, NULL, ctx->frame_raw);
+        conn_queue_restamp(ctx);
+#else
+        ctx->frame_len = mux_build_packet(ctx, payload, wait_ms);
+        if (ctx->frame_len == 0) {
+            return 0;
+        }
+#endif
+        ctx->frame_seq = ctx->lat_seq;
+        ctx->lat_seq += ctx->frame_raw;
+    }
+    pkt->data = ctx->frame;
+    pkt->len = ctx->frame_len;
+    pkt->raw = ctx->frame_raw;
+    pkt->seq = ctx->frame_seq;
+#else
+    pkt->len = conn_next_len(ctx, payload, wait_ms);
+    pkt->raw = pkt->len;
+    pkt->seq = ctx->lat_seq;
+    if (pkt->len) {
+        pkt->data = ble_tx_peek(&ctx->tx_queue, pkt->len);
+    }
+#endif
+    return pkt->len;
+}
+
+/* 一包已经交给协议栈 (或者发送出错需要丢弃)：消费掉它 */
+static void conn_packet_done(struct bridge_conn *ctx, struct tx_pkt *pkt)
+{
+#if defined(TX_PKT_STAGED)
+    ctx->frame_len = 0;
+#else
+    ring_buf_get(&ctx->tx_queue, NULL, pkt->len);
+    conn_queue_restamp(ctx);
+    ctx->lat_seq += pkt->raw;
+#endif
+}
+
+/*
+ * DRR 调度：各连接轮流发送，每轮获得 DRR_QUANTUM 字节额度
+ * 连接被在途窗口/信用挡住时本次不再参与，等它的 sent 回调重新触发本任务。
+ * 返回 true 表示有连接只能靠兜底重试 (没有在途包却发不出去)。
+ */
+static bool drr_schedule(uint32_t *wait_ms)
+{
+    bool blocked[CONFIG_BT_MAX_CONN] = { false };
+    bool need_retry = false;
+    bool more;
+
+    do {
+        more = false;
+
+        for (int k = 0; k < CONFIG_BT_MAX_CONN; k++) {
+            struct bridge_conn *ctx = &bridge_conns[(drr_next + k) % CONFIG_BT_MAX_CONN];
+            int idx = ctx - bridge_conns;
+            uint32_t payload;
+            uint32_t len;
+            struct tx_pkt pkt;
+            int err;
+
+            if (blocked[idx] || !bridge_conn_active(ctx)) {
+                continue;
+            }
+
+            /* 1. 准备待发送数据 (不立即移除)，这样如果发送失败，数据还在 */
+            payload = tx_payload_len(ctx);
+            len = conn_next_packet(ctx, payload, wait_ms, &pkt);
+            if (len == 0) {
+                /* 没有可发的数据：空闲的连接不积累额度 */
+                ctx->deficit = 0;
+                continue;
+            }
+
+            ctx->deficit += DRR_QUANTUM;
+
+            while (len && len <= ctx->deficit) {
+                LOG_DBG("BLE TX [conn %d]: sending %d bytes", idx, len);
+
+                /* 2. 尝试通过 BLE 发送 (延迟统计要在发送前登记，完成回调可能先于返回执行) */
+                latency_submit(ctx->conn, pkt.seq, pkt.raw);
+                err = bridge_send(ctx, pkt.data, len);
+                if (err < 0) {
+                    latency_cancel(ctx->conn);
+                }
+
+                if (err == -EAGAIN || err == -ENOMEM) {
+                    /*
+                     * 重点流控逻辑：
+                     * 在途窗口满了 (-EAGAIN) 或协议栈 Buffer 满了 (-ENOMEM)。
+                     * L2CAP 通道上 -EAGAIN 表示 SDU 缓冲区全部在途 (对端信用不足时会一直在途)。
+                     * 1. 数据还在队列中，没有消费任何数据。
+                     * 2. 不做定时轮询：在途通知/SDU 完成时 nus_sent_cb 会重新触发本任务。
+                     *    只有当该连接没有任何在途包时 (Buffer 被其他流量占满)，才需要兜底重试。
+                     */
+                    nus_test_record_retry();
+                    if (bridge_tx_in_flight(ctx) == 0) {
+                        need_retry = true;
+                    }
+                    blocked[idx] = true;
+                    /* 被挡住的连接不能囤积额度，否则恢复后会一次性突发 */
+                    ctx->deficit = MIN(ctx->deficit, (int32_t)MAX(DRR_QUANTUM, payload));
+                    break;
+                }
+
+                /* 发送成功或其他错误 (可能是连接断开等)，都要消费掉数据以免死循环 */
+                conn_packet_done(ctx, &pkt);
+                ctx->deficit -= len;
+
+                if (err < 0) {
+                    LOG_ERR("BLE Send Error: %d", err);
+                } else {
+                    LOG_DBG("BLE TX [conn %d]: sent %d bytes successfully", idx, len);
+                    /* 测试统计按原始字节计算，压缩时得到的就是有效负载速率 */
+                    nus_test_record_tx(pkt.raw);
+                    ctx->stat_pkts++;
+                    ctx->stat_bytes += len;
+                    if (len < payload) {
+                        ctx->stat_partial++;
+                    }
+#if defined(CONFIG_APP_BRIDGE_COMPRESS)
+                    ctx->stat_raw += pkt.raw;
+#endif
+                }
+
+                len = conn_next_packet(ctx, payload, wait_ms, &pkt);
+            }
+
+            /* 还有数据但额度不够 (例如 L2CAP 大包)，下一轮继续累积 */
+            if (len && !blocked[idx]) {
+                more = true;
+            }
+        }
+    } while (more);
+
+    drr_next = (drr_next + 1) % CONFIG_BT_MAX_CONN;
+    return need_retry;
+}
+
+/* 重新计算唤醒消费者的整包阈值 (所有接收上行数据的连接中最小的整包负载) */
+static void ble_tx_update_kick_len(void)
+{
+    uint32_t kick_len = BLE_MTU_MAX - 3;
+
+    for (int i = 0; i < ARRAY_SIZE(bridge_conns); i++) {
+        if (bridge_conn_active(&bridge_conns[i])) {
+            kick_len = MIN(kick_len, tx_payload_len(&bridge_conns[i]));
         }
     }
+    atomic_set(&tx_kick_len, kick_len);
 }
 
-/* NUS 接收到手机数据回调 */
-static void nus_received_cb(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+/* 记录一次唤醒延迟 (唤醒请求 → 发送任务开始运行) */
+static void ble_tx_wake_record(void)
 {
-    /* 直接透传回 UART TX */
-    /* 注意：uart_poll_out 是阻塞函数，高速大量数据时建议也用 RingBuffer + TX ISR */
-    /* 但对于 Day 6 任务，RX (手机到设备) 数据量通常较小，此处简化处理 */
-    for (int i = 0; i < len; i++) {
-        uart_poll_out(uart_dev, data[i]);
+    uint32_t req = (uint32_t)atomic_set(&tx_wake_cyc, 0);
+    uint32_t us;
+
+    if (req == 0) {
+        return;
     }
+    us = k_cyc_to_us_floor32(k_cycle_get_32() - req);
+    tx_wake_count++;
+    tx_wake_sum_us += us;
+    tx_wake_max_us = MAX(tx_wake_max_us, us);
+}
+
+/* 打印唤醒延迟：对比线程模式和工作队列模式 (系统工作队列繁忙时差别明显) */
+static void ble_tx_wake_report(void)
+{
+    if (tx_wake_count == 0) {
+        return;
+    }
+    printk("TX pump (%s): %u wakeups, latency avg %u us, max %u us\n",
+           IS_ENABLED(CONFIG_APP_BRIDGE_TX_THREAD) ? "thread" : "workqueue",
+           tx_wake_count, (uint32_t)(tx_wake_sum_us / tx_wake_count), tx_wake_max_us);
+}
+
+/*
+ * 核心任务：从 RingBuffer 取数据发给 BLE
+ * 1. 把 UART 数据分发到各连接的发送队列
+ * 2. DRR 轮流从各队列发送；某个连接的在途窗口已满就不再消耗它的队列，
+ *    等它的通知发送完成 (nus_sent_cb) 后再从这里继续填充。
+ * 打包逻辑：只发整包，不足一包的尾巴在延迟预算到期或线路空闲时才发出。
+ */
+static void ble_tx_pump(void)
+{
+    uint32_t wait_ms = UINT32_MAX;
+    bool need_retry = false;
+    uint32_t moved;
+
+    ble_tx_wake_record();
+    ble_tx_update_kick_len();
+
+#if defined(CONFIG_APP_NUS_TEST)
+    /* 测试模式下和吞吐量报告一起周期性打印唤醒延迟 */
+    if (k_uptime_get_32() - tx_wake_report_ms >= CONFIG_APP_NUS_TEST_REPORT_INTERVAL_MS) {
+        tx_wake_report_ms = k_uptime_get_32();
+        ble_tx_wake_report();
+    }
+#endif
+
+    /* 队列腾出空间后继续分发，直到 UART 数据发完或某个队列塞满 */
+    do {
+        /* 吞吐量测试 (发生器) 模式：用测试数据流代替 UART 把 RingBuffer 填满 */
+        latency_ingress(nus_test_generate(&uart_ring_buf));
+
+        moved = uart_fanout();
+        need_retry |= drr_schedule(&wait_ms);
+    } while (moved && (!ring_buf_is_empty(&uart_ring_buf) || !spool_is_empty()));
+
+    if (need_retry) {
+        LOG_DBG("BLE Stack Full, retrying later...");
+        ble_tx_wake_after(WORK_RETRY_DELAY);
+    } else if (wait_ms != UINT32_MAX) {
+        /* 还有不足一包的尾巴，等延迟预算到期 */
+        ble_tx_wake_after(K_MSEC(wait_ms));
+    }
+
+    uart_rx_check_resume();
+}
+
+#if defined(CONFIG_APP_BRIDGE_TX_THREAD)
+static void ble_tx_timer_expiry(struct k_timer *timer)
+{
+    ble_tx_wake();
+}
+
+/*
+ * 发送线程：等信号 → 运行一次发送任务
+ * 先复位信号再运行，运行期间到来的唤醒请求会让下一次 k_poll 立即返回，不会丢失。
+ * 运行前停掉延迟唤醒定时器：这次运行已经覆盖了它要做的事，需要时会重新安排
+ * (与 k_work_reschedule 取消原来的延迟相同)。
+ */
+static void ble_tx_thread(void *p1, void *p2, void *p3)
+{
+    struct k_poll_event event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+                                                         K_POLL_MODE_NOTIFY_ONLY,
+                                                         &ble_tx_signal);
+
+    while (1) {
+        k_poll(&event, 1, K_FOREVER);
+        k_poll_signal_reset(&ble_tx_signal);
+        event.state = K_POLL_STATE_NOT_READY;
+
+        k_timer_stop(&ble_tx_timer);
+        ble_tx_pump();
+    }
+}
+
+K_THREAD_DEFINE(ble_tx_tid, BLE_TX_THREAD_STACK_SIZE, ble_tx_thread, NULL, NULL, NULL,
+                K_PRIO_COOP(CONFIG_APP_BRIDGE_TX_THREAD_PRIO), 0, 0);
+#else
+static void ble_tx_work_handler(struct k_work *work)
+{
+    ble_tx_pump();
+}
+#endif /* CONFIG_APP_BRIDGE_TX_THREAD */
+
+/*
+ * 下行控制台数据：只把数据放进下行缓冲区就返回，真正的 UART 发送在后台进行。
+ */
+static int downlink_console_put(const uint8_t *data, uint16_t len)
+{
+    /* 吞吐量测试 (接收端) 模式：只校验数据，不透传 */
+    if (IS_ENABLED(CONFIG_APP_NUS_TEST)) {
+        nus_test_sink(data, len);
+        return 0;
+    }
+
+    /* 整包放不下就整包拒绝，避免写进半包 */
+    if (ring_buf_space_get(&uart_tx_ring_buf) < len) {
+        downlink_stat_refused += len;
+        return -ENOMEM;
+    }
+    ring_buf_put(&uart_tx_ring_buf, data, len);
+    downlink_stat_bytes += len;
+
+    /* 超过高水位：通知手机暂停写入 */
+    if (ring_buf_size_get(&uart_tx_ring_buf) >= UART_TX_HIGH_WATERMARK &&
+        atomic_cas(&downlink_xoff, 0, 1)) {
+        downlink_stat_xoff++;
+        k_work_submit(&downlink_flow_work);
+    }
+
+    uart_tx_kick();
     gpio_pin_toggle_dt(&led_act);
+    return 0;
+}
+
+#if defined(CONFIG_APP_BRIDGE_MUX)
+/* 控制通道命令：PING 原样回 PONG (对端用它测量控制消息在大流量下的往返延迟) */
+static void mux_control_received(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+{
+    uint8_t rsp[MUX_MSG_MAX];
+    int err;
+
+    if (data[0] != MUX_CTRL_PING || len > sizeof(rsp)) {
+        LOG_WRN("Unknown control command 0x%02x", data[0]);
+        return;
+    }
+
+    memcpy(rsp, data, len);
+    rsp[0] = MUX_CTRL_PONG;
+    err = mux_send(conn, MUX_CH_CONTROL, rsp, len);
+    if (err) {
+        LOG_WRN("PONG dropped (err %d)", err);
+    }
+}
+
+/* 下行的一个帧 (已通过 CRC 校验) */
+static void mux_received(struct bt_conn *conn, uint8_t ch, const uint8_t *data, uint16_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    switch (ch) {
+    case MUX_CH_CONTROL:
+        mux_control_received(conn, data, len);
+        break;
+    case MUX_CH_CONSOLE:
+        downlink_console_put(data, len);
+        break;
+    default:
+        /* 设备本身不消费下行传感器数据 */
+        LOG_DBG("Channel %u: %u bytes ignored", ch, len);
+        break;
+    }
+}
+
+/* 有新的控制/传感器消息排队：立即唤醒消费者 (控制消息不参与打包等待) */
+static void mux_pending(void)
+{
+    ble_tx_wake();
+}
+#endif /* CONFIG_APP_BRIDGE_MUX */
+
+/*
+ * NUS (或 L2CAP) 接收到手机数据回调 (运行在蓝牙 RX 线程)
+ */
+static int nus_received_cb(struct bt_conn *conn, const uint8_t *data, uint16_t len)
+{
+#if defined(CONFIG_APP_BRIDGE_MUX)
+    uint32_t ch_bytes[MUX_CH_COUNT];
+
+    /* 先检查整包所有帧的 CRC；任何一帧出错整包丢弃 */
+    if (mux_check(data, len, ch_bytes)) {
+        LOG_WRN("Bad mux frame, %u bytes dropped", len);
+        return 0;
+    }
+
+    /*
+     * 控制台数据放不下就整包拒绝 (包里的控制帧也先不执行)，
+     * 这样 L2CAP 稍后重投同一个 SDU 时不会重复执行控制命令
+     */
+    if (!IS_ENABLED(CONFIG_APP_NUS_TEST) &&
+        ring_buf_space_get(&uart_tx_ring_buf) < ch_bytes[MUX_CH_CONSOLE]) {
+        downlink_stat_refused += ch_bytes[MUX_CH_CONSOLE];
+        return -ENOMEM;
+    }
+
+    mux_dispatch(conn, data, len, mux_received);
+    return 0;
+#else
+    return downlink_console_put(data, len);
+#endif
+}
+
+/* 通知 (或 L2CAP SDU) 发送完成回调：窗口腾出空位，立即补充下一包 */
+static void nus_sent_cb(struct bt_conn *conn)
+{
+    bool pending = !ring_buf_is_empty(&bridge_conn_get(conn)->tx_queue) || !spool_is_empty();
+
+    latency_sent(conn);
+    nus_test_record_sent();
+
+#if defined(CONFIG_APP_BRIDGE_MUX)
+    pending |= mux_has_pending(conn, MUX_CH_CONTROL) || mux_has_pending(conn, MUX_CH_SENSOR);
+#endif
+
+    if (pending) {
+        ble_tx_wake();
+    } else if (!ring_buf_is_empty(&uart_ring_buf)) {
+        ble_tx_kick(false);
+    }
+}
+
+/* 对端订阅了 TX 通知或打开了 L2CAP 通道：测试模式从这里开始计时并启动发生器 */
+static void nus_send_enabled_cb(void)
+{
+    if (!IS_ENABLED(CONFIG_APP_NUS_TEST)) {
+        return;
+    }
+
+    /* 测试统计不区分连接，第一个开始接收的连接启动测试 (已启动时再次调用无效) */
+    for (int i = 0; i < ARRAY_SIZE(bridge_conns); i++) {
+        if (bridge_conn_active(&bridge_conns[i])) {
+            nus_test_start(bridge_conns[i].conn);
+            ble_tx_wake();
+            return;
+        }
+    }
 }
 
 /* NUS 初始化结构体 */
 static struct my_nus_cb nus_callbacks = {
     .received = nus_received_cb,
-    .send_enabled = NULL,
+    .send_enabled = nus_send_enabled_cb,
+    .sent = nus_sent_cb,
 };
 
 /* ============================================================
  *  BLE 连接管理
  * ============================================================ */
 
+/* 当前连接数 */
+static int bridge_conn_count(void)
+{
+    int count = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(bridge_conns); i++) {
+        if (bridge_conns[i].conn) {
+            count++;
+        }
+    }
+    return count;
+}
 
 static void connected(struct bt_conn *conn, uint8_t err)
 {
+    struct bridge_conn *ctx;
+
     if (err) {
         LOG_ERR("Connection failed (err 0x%02x)", err);
         return;
     }
 
-    LOG_INF("Connected");
-    current_conn = bt_conn_ref(conn);
+    LOG_INF("Connected (index %u)", bt_conn_index(conn));
+
+    /* 第一个连接建立时清零全局统计 (UART 和下行缓冲区是所有连接共用的) */
+    if (bridge_conn_count() == 0) {
+        rx_stat_bytes = 0;
+        rx_stat_dropped = 0;
+        rx_stat_overrun = 0;
+        rx_stat_pauses = 0;
+        downlink_stat_bytes = 0;
+        downlink_stat_refused = 0;
+        downlink_stat_xoff = 0;
+        latency_reset();
+        tx_wake_count = 0;
+        tx_wake_sum_us = 0;
+        tx_wake_max_us = 0;
+    }
+
+    /* 初始化该连接的上下文 */
+    ctx = bridge_conn_get(conn);
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->mtu = 23; // 默认 MTU，MTU 交换后会更新
+    ring_buf_init(&ctx->tx_queue, sizeof(ctx->tx_queue_buf), ctx->tx_queue_buf);
+    latency_conn_reset(conn);
+#if defined(CONFIG_APP_BRIDGE_COMPRESS)
+    lz_encoder_init(&ctx->lz);
+#endif
+    ctx->conn = bt_conn_ref(conn);
+
     gpio_pin_set_dt(&led_conn, 1);
 
     /* --- Day 7 新增逻辑 --- */
 
-    /* 1. 发起 MTU 交换请求 */
-    /* 注意：有些手机作为 Master 会主动发起，但作为 Slave 主动请求更保险 */
-    int ret = bt_gatt_exchange_mtu(conn, &exchange_params);
-    if (ret) {
-        LOG_WRN("MTU exchange request failed (err %d)", ret);
-    }
+    /*
+     * 按顺序优化链路：MTU 交换 → DLE → 2M PHY → 连接参数
+     * 同时发起多个 LL 过程容易互相冲突，一步完成后再做下一步；全部完成后才开始大批量发送
+     */
+    link_opt_start(conn);
+}
 
-    /* 2. 请求切换到 2M PHY */
-    /* 建议稍微延时一下再请求，避免连接建立初期的拥堵，或者直接请求也可 */
-    const struct bt_conn_le_phy_param preferred_phy = {
-        .options = BT_CONN_LE_PHY_OPT_NONE,
-        .pref_tx_phy = BT_GAP_LE_PHY_2M,
-        .pref_rx_phy = BT_GAP_LE_PHY_2M,
-    };
-    ret = bt_conn_le_phy_update(conn, &preferred_phy);
-    if (ret) {
-        LOG_WRN("PHY update request failed (err %d)", ret);
+/* ATT MTU 变化 (链路优化中的交换，或之后对端再次发起)：更新该连接的整包负载 */
+static void att_mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+    struct bridge_conn *ctx = bridge_conn_get(conn);
+
+    if (ctx->conn != conn) {
+        return;
     }
+    ctx->mtu = bt_gatt_get_mtu(conn);
+    /* 整包阈值在发送任务中重新计算 */
+    ble_tx_wake();
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+    .att_mtu_updated = att_mtu_updated,
+};
+
+/* 链路优化完成：更新 MTU，开始向该连接发送 (队列从此时的数据流位置开始) */
+static void link_ready(struct bt_conn *conn)
+{
+    bridge_conn_get(conn)->mtu = bt_gatt_get_mtu(conn);
+
+    /* 链路优化只在连接时选一次 PHY，之后按链路质量自动升降 (可选) */
+    phy_mgr_start(conn);
+
+    /* 对端可能在优化期间就已经订阅了，测试模式在这里补上启动 */
+    nus_send_enabled_cb();
+    ble_tx_wake();
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
-    LOG_INF("Disconnected (reason 0x%02x)", reason);
-    if (current_conn) {
-        bt_conn_unref(current_conn);
-        current_conn = NULL;
+    struct bridge_conn *ctx = bridge_conn_get(conn);
+
+    LOG_INF("Disconnected (index %u, reason 0x%02x)", bt_conn_index(conn), reason);
+    if (!ctx->conn) {
+        return;
     }
+
+    ble_tx_stats_report(ctx);
+    bt_conn_unref(ctx->conn);
+    ctx->conn = NULL;
+
+    /* 该连接队列里没发出的数据直接丢弃；其他连接不受影响，唤醒消费者继续分发 */
+    ble_tx_wake();
+
+    if (bridge_conn_count() > 0) {
+        return;
+    }
+
+    /* 最后一个连接断开 */
+    uart_rx_stats_report();
+    downlink_stats_report();
+    latency_dump();
+    ble_tx_wake_report();
+    nus_test_stop();
+    atomic_clear(&downlink_xoff);
+    my_nus_set_flow(NULL, false);
     gpio_pin_set_dt(&led_conn, 0); // LED 灭
 }
 
@@ -293,11 +1614,26 @@ int main(void)
     gpio_pin_configure_dt(&led_conn, GPIO_OUTPUT_INACTIVE);
     gpio_pin_configure_dt(&led_act, GPIO_OUTPUT_INACTIVE);
     
-    err = uart_init();
-    if (err) return 0;
+    /* 测试模式下数据由设备自己产生/校验，不需要 UART */
+    if (!IS_ENABLED(CONFIG_APP_NUS_TEST)) {
+        err = uart_init();
+        if (err) return 0;
+    }
+
+    /* 断线期间的 Flash 缓存 (可选)，打开失败时退回丢弃数据的旧行为 */
+    spool_init();
 
-    /* 初始化 WorkQueue 任务 */
+    /* 初始化 WorkQueue 任务 (线程模式下发送任务由 K_THREAD_DEFINE 创建) */
+#if !defined(CONFIG_APP_BRIDGE_TX_THREAD)
     k_work_init_delayable(&ble_tx_work, ble_tx_work_handler);
+#endif
+    k_work_init(&downlink_flow_work, downlink_flow_work_handler);
+    link_opt_init(link_ready);
+    bt_gatt_cb_register(&gatt_callbacks);
+    latency_init();
+#if defined(CONFIG_APP_BRIDGE_MUX)
+    mux_init(mux_pending);
+#endif
 
     /* 2. BLE 初始化 */
     err = bt_enable(NULL);
@@ -310,10 +1646,22 @@ int main(void)
         LOG_ERR("NUS init failed (err %d)", err);
         return 0;
     }
+    /* L2CAP 透传通道 (可选)，与 NUS 共用同一组回调 */
+    err = l2cap_bridge_init(&nus_callbacks);
+    if (err) {
+        LOG_ERR("L2CAP bridge init failed (err %d)", err);
+        return 0;
+    }
+    /* PHY 自动选择 (可选)，要在 bt_enable 之后打开控制器的 QoS 报告 */
+    phy_mgr_init();
 
     LOG_INF("Bluetooth initialized, starting advertising...");
 
-    /* 3. 开始广播 */
+    /*
+     * 3. 开始广播
+     * BT_LE_ADV_CONN 不带 ONE_TIME 选项：连接建立后只要还有空闲的连接对象
+     * (CONFIG_BT_MAX_CONN)，协议栈会自动恢复广播，其他设备可以继续连接
+     */
     err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
     if (err) {
         LOG_ERR("Advertising failed to start (err %d)", err);
@@ -0,0 +1,220 @@
+/*
+ * Module: Bridge Mux
+ * Description: 逻辑通道的帧编解码和每个连接的消息队列
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/logging/log.h>
+
+#include "mux.h"
+
+LOG_MODULE_REGISTER(mux, LOG_LEVEL_INF);
+
+/* ----------------配置部分---------------- */
+#define MUX_CONTROL_QUEUE_SIZE  256
+#define MUX_SENSOR_QUEUE_SIZE   1024
+
+/*
+ * 每个连接的消息队列 (按 bt_conn_index 索引)
+ * 队列里每条消息的格式为 [len (2)][data]，取出时原地组帧
+ */
+struct mux_conn {
+    struct ring_buf control;
+    struct ring_buf sensor;
+    uint8_t control_buf[MUX_CONTROL_QUEUE_SIZE];
+    uint8_t sensor_buf[MUX_SENSOR_QUEUE_SIZE];
+    bool connected;
+};
+
+static struct mux_conn mux_conns[CONFIG_BT_MAX_CONN];
+static struct k_spinlock mux_lock;
+static void (*pending_cb)(void);
+
+static struct ring_buf *mux_queue(struct mux_conn *mc, uint8_t ch)
+{
+    switch (ch) {
+    case MUX_CH_CONTROL:
+        return &mc->control;
+    case MUX_CH_SENSOR:
+        return &mc->sensor;
+    default:
+        return NULL;
+    }
+}
+
+static uint16_t mux_crc(const uint8_t *frame, uint16_t len)
+{
+    return crc16_ccitt(0xFFFF, frame, MUX_HDR_LEN + len);
+}
+
+/* ----------------连接回调---------------- */
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    struct mux_conn *mc = &mux_conns[bt_conn_index(conn)];
+    k_spinlock_key_t key;
+
+    if (err) {
+        return;
+    }
+
+    key = k_spin_lock(&mux_lock);
+    ring_buf_init(&mc->control, sizeof(mc->control_buf), mc->control_buf);
+    ring_buf_init(&mc->sensor, sizeof(mc->sensor_buf), mc->sensor_buf);
+    mc->connected = true;
+    k_spin_unlock(&mux_lock, key);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    mux_conns[bt_conn_index(conn)].connected = false;
+}
+
+BT_CONN_CB_DEFINE(mux_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+};
+
+/* ----------------对外接口---------------- */
+
+void mux_init(void (*pending)(void))
+{
+    pending_cb = pending;
+}
+
+int mux_send(struct bt_conn *conn, uint8_t ch, const uint8_t *data, uint16_t len)
+{
+    uint8_t hdr[2];
+    k_spinlock_key_t key;
+    int first = conn ? bt_conn_index(conn) : 0;
+    int last = conn ? first : CONFIG_BT_MAX_CONN - 1;
+    bool queued = false;
+
+    if (!mux_queue(&mux_conns[0], ch) || len == 0 || len > MUX_MSG_MAX) {
+        return -EINVAL;
+    }
+    sys_put_le16(len, hdr);
+
+    key = k_spin_lock(&mux_lock);
+
+    /* 先确认所有目标连接都放得下，避免只发给了一部分连接 */
+    for (int i = first; i <= last; i++) {
+        struct mux_conn *mc = &mux_conns[i];
+
+        if (mc->connected && ring_buf_space_get(mux_queue(mc, ch)) < sizeof(hdr) + len) {
+            k_spin_unlock(&mux_lock, key);
+            return -ENOMEM;
+        }
+    }
+
+    for (int i = first; i <= last; i++) {
+        struct mux_conn *mc = &mux_conns[i];
+
+        if (mc->connected) {
+            ring_buf_put(mux_queue(mc, ch), hdr, sizeof(hdr));
+            ring_buf_put(mux_queue(mc, ch), data, len);
+            queued = true;
+        }
+    }
+
+    k_spin_unlock(&mux_lock, key);
+
+    if (!queued) {
+        return -ENOTCONN;
+    }
+    if (pending_cb) {
+        pending_cb();
+    }
+    return 0;
+}
+
+bool mux_has_pending(struct bt_conn *conn, uint8_t ch)
+{
+    struct ring_buf *q = mux_queue(&mux_conns[bt_conn_index(conn)], ch);
+
+    return q && !ring_buf_is_empty(q);
+}
+
+uint32_t mux_take(struct bt_conn *conn, uint8_t ch, uint8_t *out, uint32_t room)
+{
+    struct ring_buf *q = mux_queue(&mux_conns[bt_conn_index(conn)], ch);
+    uint32_t o = 0;
+    uint8_t hdr[2];
+    k_spinlock_key_t key;
+
+    if (!q) {
+        return 0;
+    }
+
+    key = k_spin_lock(&mux_lock);
+    while (ring_buf_peek(q, hdr, sizeof(hdr)) == sizeof(hdr)) {
+        uint16_t len = sys_get_le16(hdr);
+
+        /* 严格按顺序：队首的消息放不下就停，后面的消息也不超车 */
+        if (len + MUX_OVERHEAD > room - o) {
+            break;
+        }
+        ring_buf_get(q, NULL, sizeof(hdr));
+        ring_buf_get(q, out + o + MUX_HDR_LEN, len);
+        o += mux_frame_put(out + o, ch, out + o + MUX_HDR_LEN, len);
+    }
+    k_spin_unlock(&mux_lock, key);
+
+    return o;
+}
+
+uint32_t mux_frame_put(uint8_t *out, uint8_t ch, const uint8_t *data, uint16_t len)
+{
+    if (data != out + MUX_HDR_LEN) {
+        memmove(out + MUX_HDR_LEN, data, len);
+    }
+    sys_put_le16(len, out);
+    out[2] = ch;
+    sys_put_le16(mux_crc(out, len), out + MUX_HDR_LEN + len);
+
+    return len + MUX_OVERHEAD;
+}
+
+int mux_check(const uint8_t *buf, uint32_t len, uint32_t ch_bytes[MUX_CH_COUNT])
+{
+    uint32_t i = 0;
+
+    if (ch_bytes) {
+        memset(ch_bytes, 0, MUX_CH_COUNT * sizeof(ch_bytes[0]));
+    }
+
+    while (i < len) {
+        uint16_t flen;
+
+        if (len - i < MUX_OVERHEAD) {
+            return -EBADMSG;
+        }
+        flen = sys_get_le16(buf + i);
+        if (flen + MUX_OVERHEAD > len - i || buf[i + 2] >= MUX_CH_COUNT ||
+            mux_crc(buf + i, flen) != sys_get_le16(buf + i + MUX_HDR_LEN + flen)) {
+            return -EBADMSG;
+        }
+        if (ch_bytes) {
+            ch_bytes[buf[i + 2]] += flen;
+        }
+        i += flen + MUX_OVERHEAD;
+    }
+
+    return 0;
+}
+
+void mux_dispatch(struct bt_conn *conn, const uint8_t *buf, uint32_t len, mux_rx_cb_t cb)
+{
+    uint32_t i = 0;
+
+    while (i + MUX_OVERHEAD <= len) {
+        uint16_t flen = sys_get_le16(buf + i);
+
+        cb(conn, buf[i + 2], buf + i + MUX_HDR_LEN, flen);
+        i += flen + MUX_OVERHEAD;
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * Module: Bridge Mux
+ * Description: 在 NUS (或 L2CAP) 字节管道上复用多个逻辑通道
+ *
+ * 帧格式 (小端)：
+ *   +---------+---------+------+-------------+---------+
+ *   | len (2) | ch (1)  | payload (len)      | crc (2) |
+ *   +---------+---------+------+-------------+---------+
+ *   crc: CRC-16/CCITT (初值 0xFFFF)，覆盖 len、ch 和 payload
+ *
+ * 每个帧都完整地放在一个通知/SDU/写入里，不跨包，接收端不需要重组。
+ * 发送时按严格优先级拼包：控制 → 控制台 (UART 透传) → 传感器，
+ * 控制消息最多只需要等已经交给协议栈的几包，不会排在 uart_ring_buf 的大量数据后面。
+ */
+
+#ifndef MUX_H_
+#define MUX_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief 逻辑通道 (数值越小优先级越高) */
+enum mux_channel {
+    MUX_CH_CONTROL = 0,     /**< 控制命令/应答，最高优先级 */
+    MUX_CH_CONSOLE = 1,     /**< UART 透传数据 */
+    MUX_CH_SENSOR = 2,      /**< 二进制传感器数据，最低优先级 */
+    MUX_CH_COUNT,
+};
+
+#define MUX_HDR_LEN   3
+#define MUX_CRC_LEN   2
+#define MUX_OVERHEAD  (MUX_HDR_LEN + MUX_CRC_LEN)
+
+/** @brief 控制/传感器通道单条消息的最大长度 (MTU 23 时也能放进一包) */
+#define MUX_MSG_MAX   (23 - 3 - MUX_OVERHEAD)
+
+/** @brief 控制通道的命令 (payload 第一个字节) */
+#define MUX_CTRL_PING  0x01     /**< 对端发起，设备原样回 PONG (用于测量控制消息延迟) */
+#define MUX_CTRL_PONG  0x81
+
+/** @brief 收到一个帧时的回调 */
+typedef void (*mux_rx_cb_t)(struct bt_conn *conn, uint8_t ch, const uint8_t *data,
+                            uint16_t len);
+
+/**
+ * @brief 初始化
+ * @param pending 有新的控制/传感器消息排队时调用 (用来唤醒发送任务)
+ */
+void mux_init(void (*pending)(void));
+
+/**
+ * @brief 在控制或传感器通道上发送一条消息
+ *
+ * 消息先放进每个连接自己的队列，由发送任务按优先级拼包。
+ * 控制台通道的数据来自 UART，不通过本函数发送。
+ *
+ * @param conn 连接 (NULL 表示所有连接，整条消息要么全部入队要么都不入队)
+ * @return 0 成功, -EINVAL 通道或长度不对, -ENOMEM 队列满
+ */
+int mux_send(struct bt_conn *conn, uint8_t ch, const uint8_t *data, uint16_t len);
+
+/** @brief 该连接的某个通道是否有排队的消息 */
+bool mux_has_pending(struct bt_conn *conn, uint8_t ch);
+
+/**
+ * @brief 从该连接的某个通道队列取出尽可能多的完整帧
+ * @param out  输出位置
+ * @param room 可用空间
+ * @return 写入的字节数
+ */
+uint32_t mux_take(struct bt_conn *conn, uint8_t ch, uint8_t *out, uint32_t room);
+
+/**
+ * @brief 组一个帧
+ *
+ * data 可以已经位于 out + MUX_HDR_LEN (原地组帧，省一次拷贝)。
+ *
+ * @return 帧长度 (len + MUX_OVERHEAD)
+ */
+uint32_t mux_frame_put(uint8_t *out, uint8_t ch, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 检查一包里的所有帧 (长度和 CRC)，并统计各通道的负载字节数
+ * @param ch_bytes 输出各通道负载总长，可以为 NULL
+ * @return 0 全部正确, -EBADMSG 格式或 CRC 错误
+ */
+int mux_check(const uint8_t *buf, uint32_t len, uint32_t ch_bytes[MUX_CH_COUNT]);
+
+/**
+ * @brief 逐帧分发 (调用前先用 mux_check 检查)
+ */
+void mux_dispatch(struct bt_conn *conn, const uint8_t *buf, uint32_t len, mux_rx_cb_t cb);
+
+#endif /* MUX_H_ */
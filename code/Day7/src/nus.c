@@ -1,24 +1,67 @@
 /*
  * Module: My NUS Implementation
  * Description: 实现 NUS GATT 服务
+ *
+ * CONFIG_APP_BRIDGE_EATT: 上行大批量通知只走 EATT 信道 (链路优化时建立，只有一条，
+ * 保证顺序)，流控通知和手机的读写请求留在传统 ATT 信道，不会排在数据通知后面。
  */
 
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/att.h>
 #include <zephyr/logging/log.h>
 
 #include "nus.h"
 
 LOG_MODULE_REGISTER(my_nus, LOG_LEVEL_ERR);
 
+/* ----------------配置部分---------------- */
+/*
+ * 1: 通知时按 UUID 在整个属性数据库里查找 (旧实现)，只用于对比每次通知的 CPU 周期
+ *    (吞吐量测试报告中的 notify cyc)
+ */
+#define MY_NUS_NOTIFY_BY_UUID  0
+
+/*
+ * my_nus_svc 中各属性的下标，与下面 BT_GATT_SERVICE_DEFINE 的顺序一一对应
+ * (每个 BT_GATT_CHARACTERISTIC 展开为声明 + 值两个属性)。
+ * 发送路径直接用下标取属性，不再按 UUID 查找；顺序改了编译时数量检查会报错。
+ */
+enum {
+    MY_NUS_ATTR_SVC,
+    MY_NUS_ATTR_RX_CHRC,
+    MY_NUS_ATTR_RX_VALUE,
+    MY_NUS_ATTR_TX_CHRC,
+    MY_NUS_ATTR_TX_VALUE,
+    MY_NUS_ATTR_TX_CCC,
+    MY_NUS_ATTR_FLOW_CHRC,
+    MY_NUS_ATTR_FLOW_VALUE,
+    MY_NUS_ATTR_FLOW_CCC,
+    MY_NUS_ATTR_COUNT,
+};
+
+BUILD_ASSERT(MY_NUS_TX_WINDOW > 0, "TX Buffer 数量不足以维持通知窗口");
+BUILD_ASSERT(MY_NUS_TX_WINDOW * CONFIG_BT_MAX_CONN < MY_NUS_TX_BUF_COUNT,
+             "通知窗口占满全部 TX Buffer，发送线程里的 bt_gatt_notify_cb 会阻塞");
+
 static struct my_nus_cb nus_cb;
 
+/* 每个连接已交给协议栈、尚未收到发送完成回调的通知数量 (按 bt_conn_index 索引) */
+static atomic_t tx_in_flight[CONFIG_BT_MAX_CONN];
+
+/* 当前下行流控状态 (MY_NUS_FLOW_XON / MY_NUS_FLOW_XOFF)，所有连接共用一个下行缓冲区 */
+static uint8_t flow_state = MY_NUS_FLOW_XON;
+
 /* TX Characteristic (Notify) 的配置改变回调 (CCC Write) */
 static void on_cccd_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
     bool notif_enabled = (value == BT_GATT_CCC_NOTIFY);
     LOG_INF("NUS Notifications %s", notif_enabled ? "enabled" : "disabled");
+
+    if (notif_enabled && nus_cb.send_enabled) {
+        nus_cb.send_enabled();
+    }
 }
 
 /* RX Characteristic (Write) 的写入回调 */
@@ -27,12 +70,29 @@ static ssize_t on_receive_data(struct bt_conn *conn, const struct bt_gatt_attr *
                                uint8_t flags)
 {
     LOG_DBG("Received %d bytes", len);
-    if (nus_cb.received) {
-        nus_cb.received(conn, buf, len);
+    if (nus_cb.received && nus_cb.received(conn, buf, len)) {
+        if (!(flags & BT_GATT_WRITE_FLAG_CMD)) {
+            /* Write Request：返回错误，手机收到后可以稍后重发 */
+            return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+        }
+        /* Write Command 没有响应可回，只能丢弃 (手机没有遵守 XOFF) */
+        LOG_WRN("Downlink full, dropped %d bytes", len);
     }
     return len;
 }
 
+/* Flow Characteristic 的读取回调 */
+static ssize_t on_read_flow(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                            void *buf, uint16_t len, uint16_t offset)
+{
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &flow_state, sizeof(flow_state));
+}
+
+static void on_flow_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    LOG_INF("NUS Flow notifications %s", value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
+}
+
 /* 
  * 定义 GATT 服务 
  * 结构：
@@ -57,29 +117,136 @@ BT_GATT_SERVICE_DEFINE(my_nus_svc,
     
     /* TX 的 CCC 描述符，允许手机开启/关闭通知 */
     BT_GATT_CCC(on_cccd_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    /* Flow: 设备下行缓冲区快满时通知手机暂停写入 (XOFF)，排空后再恢复 (XON) */
+    BT_GATT_CHARACTERISTIC(BT_UUID_MY_NUS_FLOW,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ,
+                           on_read_flow, NULL, NULL),
+    BT_GATT_CCC(on_flow_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 );
 
+BUILD_ASSERT(ARRAY_SIZE(attr_my_nus_svc) == MY_NUS_ATTR_COUNT,
+             "my_nus_svc 的属性顺序与 MY_NUS_ATTR_* 下标不一致");
+
+/* 通知发送完成回调 (在协议栈 TX 完成上下文中执行) */
+static void on_sent(struct bt_conn *conn, void *user_data)
+{
+    atomic_t *in_flight = &tx_in_flight[bt_conn_index(conn)];
+    atomic_val_t old;
+
+    /* 断开时计数已被清零，晚到的完成回调不能把计数减成负数 */
+    do {
+        old = atomic_get(in_flight);
+        if (old == 0) {
+            break;
+        }
+    } while (!atomic_cas(in_flight, old, old - 1));
+
+    if (nus_cb.sent) {
+        nus_cb.sent(conn);
+    }
+}
+
+/*
+ * 连接断开后，未完成的通知不会再有回调，直接清空该连接的窗口
+ * 下行流控状态属于共用的下行缓冲区，由调用者通过 my_nus_set_flow 维护
+ */
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    atomic_clear(&tx_in_flight[bt_conn_index(conn)]);
+}
+
+BT_CONN_CB_DEFINE(my_nus_conn_callbacks) = {
+    .disconnected = on_disconnected,
+};
+
 int my_nus_init(struct my_nus_cb *callbacks)
 {
     if (!callbacks) {
         return -EINVAL;
     }
+
+    /* 数量对得上但顺序被调换时，在这里 (CONFIG_ASSERT=y) 发现 */
+    __ASSERT(!bt_uuid_cmp(my_nus_svc.attrs[MY_NUS_ATTR_TX_VALUE].uuid, BT_UUID_MY_NUS_TX),
+             "MY_NUS_ATTR_TX_VALUE mismatch");
+    __ASSERT(!bt_uuid_cmp(my_nus_svc.attrs[MY_NUS_ATTR_FLOW_VALUE].uuid, BT_UUID_MY_NUS_FLOW),
+             "MY_NUS_ATTR_FLOW_VALUE mismatch");
+
     nus_cb = *callbacks;
     return 0;
 }
 
 int my_nus_send(struct bt_conn *conn, const uint8_t *data, uint16_t len)
 {
+    atomic_t *in_flight;
+    struct bt_gatt_notify_params params = {
+#if MY_NUS_NOTIFY_BY_UUID
+        .uuid = BT_UUID_MY_NUS_TX,
+#else
+        .attr = &my_nus_svc.attrs[MY_NUS_ATTR_TX_VALUE],
+#endif
+        .data = data,
+        .len = len,
+        .func = on_sent,
+    };
     int err;
-    
+
     LOG_DBG("my_nus_send: conn=%p, len=%d", (void *)conn, len);
-    
-    /* 使用 bt_gatt_notify_uuid 发送数据 */
-    err = bt_gatt_notify_uuid(conn, BT_UUID_MY_NUS_TX, NULL, data, len);
-    
+
+    if (!conn) {
+        return -EINVAL;
+    }
+    in_flight = &tx_in_flight[bt_conn_index(conn)];
+
+#if defined(CONFIG_APP_BRIDGE_EATT)
+    /* 没有 EATT 信道 (对端不支持) 时退回任意信道 */
+    if (bt_eatt_count(conn) > 0) {
+        params.chan_opt = BT_ATT_CHAN_OPT_ENHANCED_ONLY;
+    }
+#endif
+
+    /* 窗口已满：不再往协议栈塞数据，等 on_sent 回调腾出空位 */
+    if (atomic_inc(in_flight) >= MY_NUS_TX_WINDOW) {
+        atomic_dec(in_flight);
+        return -EAGAIN;
+    }
+
+    /* 使用 bt_gatt_notify_cb 发送数据，发送完成后协议栈回调 on_sent */
+    err = bt_gatt_notify_cb(conn, &params);
     if (err) {
-        LOG_ERR("bt_gatt_notify_uuid failed: %d", err);
+        atomic_dec(in_flight);
+        if (err != -ENOMEM) {
+            LOG_ERR("bt_gatt_notify_cb failed: %d", err);
+        }
     }
-    
+
     return err;
+}
+
+uint32_t my_nus_tx_in_flight(struct bt_conn *conn)
+{
+    return (uint32_t)atomic_get(&tx_in_flight[bt_conn_index(conn)]);
+}
+
+bool my_nus_is_subscribed(struct bt_conn *conn)
+{
+    return bt_gatt_is_subscribed(conn, &my_nus_svc.attrs[MY_NUS_ATTR_TX_VALUE],
+                                 BT_GATT_CCC_NOTIFY);
+}
+
+int my_nus_set_flow(struct bt_conn *conn, bool xoff)
+{
+    struct bt_gatt_notify_params params = {
+        .attr = &my_nus_svc.attrs[MY_NUS_ATTR_FLOW_VALUE],
+        .data = &flow_state,
+        .len = sizeof(flow_state),
+#if defined(CONFIG_APP_BRIDGE_EATT)
+        .chan_opt = BT_ATT_CHAN_OPT_UNENHANCED_ONLY,
+#endif
+    };
+
+    flow_state = xoff ? MY_NUS_FLOW_XOFF : MY_NUS_FLOW_XON;
+
+    return bt_gatt_notify_cb(conn, &params);
 }
\ No newline at end of file
@@ -24,17 +24,65 @@
 #define MY_NUS_UUID_TX_VAL \
     BT_UUID_128_ENCODE(0x6E400003, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
 
+/** @brief 下行流控 Characteristic UUID (Read | Notify): ...0004... (非标准 NUS 扩展) */
+#define MY_NUS_UUID_FLOW_VAL \
+    BT_UUID_128_ENCODE(0x6E400004, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
+
 #define BT_UUID_MY_NUS_SERVICE  BT_UUID_DECLARE_128(MY_NUS_UUID_SERVICE_VAL)
 #define BT_UUID_MY_NUS_RX       BT_UUID_DECLARE_128(MY_NUS_UUID_RX_VAL)
 #define BT_UUID_MY_NUS_TX       BT_UUID_DECLARE_128(MY_NUS_UUID_TX_VAL)
+#define BT_UUID_MY_NUS_FLOW     BT_UUID_DECLARE_128(MY_NUS_UUID_FLOW_VAL)
+
+/** @brief 流控状态值：允许发送 / 暂停发送 */
+#define MY_NUS_FLOW_XON   0x00
+#define MY_NUS_FLOW_XOFF  0x01
+
+/**
+ * @brief 每个通知值的 ATT 开销 (opcode 1 + handle 2)
+ *
+ * 开启 CONFIG_BT_GATT_NOTIFY_MULTIPLE 后，对端支持时协议栈会把同一连接连续发出的通知
+ * 合并成一个 ATT_MULTIPLE_HANDLE_VALUE_NTF，每个值多 2 字节长度字段。通知负载按
+ * mtu - MY_NUS_NTF_OVERHEAD 打包，保证一个值单独也能放进多值通知 PDU。
+ */
+#if defined(CONFIG_BT_GATT_NOTIFY_MULTIPLE)
+#define MY_NUS_NTF_OVERHEAD  5
+#else
+#define MY_NUS_NTF_OVERHEAD  3
+#endif
+
+/**
+ * @brief 同时在途 (已交给协议栈、尚未发送完成) 的通知数量上限
+ *
+ * 每个在途通知都占用一个 L2CAP TX Buffer、一个 ACL TX Buffer 和一个发送上下文，
+ * 取三者最小值，并给每个连接预留 1 个给 XON/XOFF 通知和 ATT 响应 (MTU 交换、写响应等)。
+ * 窗口按连接计算，多个连接平分这些 Buffer，避免一个连接把 Buffer 占光。
+ * 所有连接的窗口加起来小于 Buffer 总数，在发送线程里 (不在系统工作队列上，
+ * bt_gatt_notify_cb 分配会一直等待) 提交通知也不会阻塞。
+ * 可在包含本头文件之前自行定义以覆盖默认值。
+ */
+#if defined(CONFIG_BT_CONN_TX_MAX)
+#define MY_NUS_TX_BUF_COUNT \
+    MIN(MIN(CONFIG_BT_L2CAP_TX_BUF_COUNT, CONFIG_BT_BUF_ACL_TX_COUNT), CONFIG_BT_CONN_TX_MAX)
+#else
+#define MY_NUS_TX_BUF_COUNT  MIN(CONFIG_BT_L2CAP_TX_BUF_COUNT, CONFIG_BT_BUF_ACL_TX_COUNT)
+#endif
+
+#ifndef MY_NUS_TX_WINDOW
+#define MY_NUS_TX_WINDOW \
+    MAX(1, (MY_NUS_TX_BUF_COUNT - CONFIG_BT_MAX_CONN) / CONFIG_BT_MAX_CONN)
+#endif
 
 /**
  * @brief 收到数据时的回调函数定义
+ *
+ * 回调运行在蓝牙 RX 线程中，不能阻塞。
+ *
  * @param conn 连接句柄
  * @param data 接收到的数据指针
  * @param len 数据长度
+ * @return 0 已全部接收, -ENOMEM 缓冲区放不下 (整包不接收)
  */
-typedef void (*my_nus_received_cb_t)(struct bt_conn *conn, const uint8_t *data, uint16_t len);
+typedef int (*my_nus_received_cb_t)(struct bt_conn *conn, const uint8_t *data, uint16_t len);
 
 /**
  * @brief NUS 初始化配置结构体
@@ -42,6 +90,7 @@ typedef void (*my_nus_received_cb_t)(struct bt_conn *conn, const uint8_t *data,
 struct my_nus_cb {
     my_nus_received_cb_t received;  /**< 当手机发数据给设备时调用 */
     void (*send_enabled)(void);     /**< 当手机订阅了 TX 通知时调用 (可选) */
+    void (*sent)(struct bt_conn *conn); /**< 一个通知发送完成、窗口腾出空位时调用 (可选) */
 };
 
 /**
@@ -53,11 +102,38 @@ int my_nus_init(struct my_nus_cb *callbacks);
 
 /**
  * @brief 发送数据给手机 (通过 Notify)
- * @param conn 连接对象 (NULL 则广播给所有已连接且订阅的设备，通常 NUS 是一对一)
+ *
+ * 发送完成后通过 my_nus_cb.sent 回调通知调用者，调用者应在回调中继续填充下一包，
+ * 而不是定时重试。
+ * 开启 CONFIG_APP_BRIDGE_EATT 且该连接已建立 EATT 信道时，只走 EATT 信道。
+ *
+ * @param conn 连接对象 (每个连接有自己的在途窗口，不能为 NULL)
  * @param data 数据指针
  * @param len 数据长度
- * @return 0 成功, -ENOMEM/-EAGAIN 缓冲区满
+ * @return 0 成功, -EAGAIN 该连接的在途窗口已满, -ENOMEM 协议栈缓冲区满
  */
 int my_nus_send(struct bt_conn *conn, const uint8_t *data, uint16_t len);
 
+/**
+ * @brief 获取某个连接当前在途 (尚未发送完成) 的通知数量
+ */
+uint32_t my_nus_tx_in_flight(struct bt_conn *conn);
+
+/**
+ * @brief 该连接是否订阅了 TX 通知
+ */
+bool my_nus_is_subscribed(struct bt_conn *conn);
+
+/**
+ * @brief 通过 Flow Characteristic 通知手机暂停/恢复写入 (下行背压)
+ *
+ * 属于控制类流量，开启 CONFIG_APP_BRIDGE_EATT 时固定走传统 ATT 信道，
+ * 不会排在 EATT 信道上的大批量通知后面。
+ *
+ * @param conn 连接对象 (NULL 则通知所有已订阅的连接)
+ * @param xoff true=暂停 (XOFF), false=恢复 (XON)
+ * @return 0 成功, 负数 失败 (例如手机没有订阅)
+ */
+int my_nus_set_flow(struct bt_conn *conn, bool xoff);
+
 #endif /* NUS_H_ */
\ No newline at end of file
@@ -0,0 +1,315 @@
+/*
+ * Module: NUS Throughput Test
+ * Description: 吞吐量测试模式实现
+ *
+ * 发生器: 在 BLE 发送任务每次运行时把 RingBuffer 填满计数流，走和 UART 透传完全相同的
+ *         打包 + 通知窗口路径，所以测到的就是透传链路本身的上限。
+ * 接收端: 校验手机/测试主机写入的计数流。
+ *
+ * 报告内容 (每 CONFIG_APP_NUS_TEST_REPORT_INTERVAL_MS 打印一次):
+ *   goodput      有效负载速率 (kbps)
+ *   notif/event  平均每个连接事件发出的通知数 (按连接间隔折算)
+ *   retries      因在途窗口/协议栈缓冲区满而放弃的发送次数
+ *   seq_err      接收端检测到的不连续次数
+ *   notify cyc   每次 my_nus_send 成功提交平均花费的 CPU 周期 (通知路径的 CPU 开销)
+ *   cpu          非空闲线程占用的 CPU 时间比例 (线程运行时统计；BabbleSim 中代码执行不占仿真时间，
+ *                只有在真实硬件上才有意义)
+ *
+ * CONFIG_APP_NUS_TEST_WQ_LOAD_US > 0 时在系统工作队列上周期性地制造忙等待负载，
+ * 用来对比发送任务跑在独立线程和系统工作队列上的唤醒延迟。
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/logging/log.h>
+
+#include "nus_test.h"
+
+LOG_MODULE_REGISTER(nus_test, LOG_LEVEL_INF);
+
+/* ----------------统计变量---------------- */
+static atomic_t stat_tx_bytes;
+static atomic_t stat_sent;
+static atomic_t stat_retries;
+static atomic_t stat_rx_bytes;
+static atomic_t stat_seq_err;
+/* 通知 CPU 周期累计值会超过 32 位，用锁保护 64 位计数 */
+static struct k_spinlock notify_lock;
+static uint32_t stat_notify_calls;
+static uint64_t stat_notify_cycles;
+
+/* 上次报告时的快照，用于计算区间速率 */
+static uint32_t last_tx_bytes;
+static uint32_t last_rx_bytes;
+static uint32_t last_sent;
+static uint32_t last_notify_calls;
+static uint64_t last_notify_cycles;
+static int64_t last_report_ms;
+static int64_t start_ms;
+
+/* CPU 负载：上次报告时 / 开始测试时的 (非空闲周期, 总周期) */
+struct cpu_sample {
+    uint64_t busy;
+    uint64_t total;
+};
+static struct cpu_sample last_cpu;
+static struct cpu_sample start_cpu;
+
+static struct bt_conn *test_conn;
+static bool running;
+
+/* 发生器下一个要写出的字节 / 接收端期望的下一个字节 */
+static uint8_t gen_next;
+static uint8_t sink_next;
+static bool sink_synced;
+
+static struct k_work_delayable report_work;
+
+/* 系统工作队列负载：每 WQ_LOAD_PERIOD_MS 忙等待 CONFIG_APP_NUS_TEST_WQ_LOAD_US */
+#define WQ_LOAD_PERIOD_MS  10
+static struct k_work_delayable load_work;
+
+/* 取当前连接间隔 (us)，用于把时间折算成连接事件数 */
+static uint32_t conn_interval_us(void)
+{
+    struct bt_conn_info info;
+
+    if (!test_conn || bt_conn_get_info(test_conn, &info)) {
+        return 0;
+    }
+    return info.le.interval * 1250U;
+}
+
+static void cpu_sample_get(struct cpu_sample *sample)
+{
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+    k_thread_runtime_stats_t stats;
+
+    if (k_thread_runtime_stats_all_get(&stats) == 0) {
+        sample->busy = stats.total_cycles;
+        sample->total = stats.execution_cycles;
+        return;
+    }
+#endif
+    sample->busy = 0;
+    sample->total = 0;
+}
+
+/* 从 from 到现在的 CPU 占用百分比 */
+static uint32_t cpu_load_pct(const struct cpu_sample *from, struct cpu_sample *now)
+{
+    uint64_t total;
+
+    cpu_sample_get(now);
+    total = now->total - from->total;
+    return total ? (uint32_t)((now->busy - from->busy) * 100 / total) : 0;
+}
+
+static void report(const char *tag, int64_t elapsed_ms, uint32_t tx_bytes,
+                   uint32_t rx_bytes, uint32_t sent, uint32_t notify_calls,
+                   uint64_t notify_cycles, uint32_t cpu_pct)
+{
+    uint32_t notify_avg = notify_calls ? (uint32_t)(notify_cycles / notify_calls) : 0;
+    uint32_t interval_us = conn_interval_us();
+    uint32_t events = 0;
+    uint32_t per_event_x100 = 0;
+
+    if (elapsed_ms <= 0) {
+        return;
+    }
+    if (interval_us) {
+        events = (uint32_t)(elapsed_ms * 1000 / interval_us);
+    }
+    if (events) {
+        per_event_x100 = sent * 100 / events;
+    }
+
+    printk("[%s] %lld ms: tx %u kbps, rx %u kbps, notif/event %u.%02u, "
+           "retries %d, seq_err %d, notify cyc %u (%u ns), cpu %u%%\n",
+           tag, elapsed_ms,
+           (uint32_t)((uint64_t)tx_bytes * 8 / elapsed_ms),
+           (uint32_t)((uint64_t)rx_bytes * 8 / elapsed_ms),
+           per_event_x100 / 100, per_event_x100 % 100,
+           (int)atomic_get(&stat_retries), (int)atomic_get(&stat_seq_err),
+           notify_avg, (uint32_t)k_cyc_to_ns_floor64(notify_avg), cpu_pct);
+}
+
+static void report_work_handler(struct k_work *work)
+{
+    int64_t now = k_uptime_get();
+    uint32_t tx_bytes = atomic_get(&stat_tx_bytes);
+    uint32_t rx_bytes = atomic_get(&stat_rx_bytes);
+    uint32_t sent = atomic_get(&stat_sent);
+    uint32_t notify_calls;
+    uint64_t notify_cycles;
+    struct cpu_sample cpu;
+    uint32_t cpu_pct;
+    k_spinlock_key_t key;
+
+    if (!running) {
+        return;
+    }
+
+    key = k_spin_lock(&notify_lock);
+    notify_calls = stat_notify_calls;
+    notify_cycles = stat_notify_cycles;
+    k_spin_unlock(&notify_lock, key);
+    cpu_pct = cpu_load_pct(&last_cpu, &cpu);
+
+    report("NUS TEST", now - last_report_ms, tx_bytes - last_tx_bytes,
+           rx_bytes - last_rx_bytes, sent - last_sent,
+           notify_calls - last_notify_calls, notify_cycles - last_notify_cycles, cpu_pct);
+
+    last_tx_bytes = tx_bytes;
+    last_rx_bytes = rx_bytes;
+    last_sent = sent;
+    last_notify_calls = notify_calls;
+    last_notify_cycles = notify_cycles;
+    last_cpu = cpu;
+    last_report_ms = now;
+
+    k_work_reschedule(&report_work, K_MSEC(CONFIG_APP_NUS_TEST_REPORT_INTERVAL_MS));
+}
+
+/* 模拟系统工作队列上的其他工作 (日志、设置、电量服务等) */
+static void load_work_handler(struct k_work *work)
+{
+    if (!running) {
+        return;
+    }
+    k_busy_wait(CONFIG_APP_NUS_TEST_WQ_LOAD_US);
+    k_work_reschedule(&load_work, K_MSEC(WQ_LOAD_PERIOD_MS));
+}
+
+/* ----------------对外接口---------------- */
+
+void nus_test_start(struct bt_conn *conn)
+{
+    if (running) {
+        return;
+    }
+
+    k_work_init_delayable(&report_work, report_work_handler);
+    k_work_init_delayable(&load_work, load_work_handler);
+
+    atomic_clear(&stat_tx_bytes);
+    atomic_clear(&stat_sent);
+    atomic_clear(&stat_retries);
+    atomic_clear(&stat_rx_bytes);
+    atomic_clear(&stat_seq_err);
+    stat_notify_calls = 0;
+    stat_notify_cycles = 0;
+    last_tx_bytes = 0;
+    last_rx_bytes = 0;
+    last_sent = 0;
+    last_notify_calls = 0;
+    last_notify_cycles = 0;
+    gen_next = 0;
+    sink_synced = false;
+
+    test_conn = conn;
+    cpu_sample_get(&start_cpu);
+    last_cpu = start_cpu;
+    start_ms = k_uptime_get();
+    last_report_ms = start_ms;
+    running = true;
+
+    LOG_INF("Throughput test started (%s)",
+            IS_ENABLED(CONFIG_APP_NUS_TEST_GENERATOR) ? "generator" : "sink");
+    k_work_reschedule(&report_work, K_MSEC(CONFIG_APP_NUS_TEST_REPORT_INTERVAL_MS));
+    if (CONFIG_APP_NUS_TEST_WQ_LOAD_US > 0) {
+        k_work_reschedule(&load_work, K_MSEC(WQ_LOAD_PERIOD_MS));
+    }
+}
+
+void nus_test_stop(void)
+{
+    struct cpu_sample cpu;
+
+    if (!running) {
+        return;
+    }
+
+    running = false;
+    k_work_cancel_delayable(&report_work);
+    k_work_cancel_delayable(&load_work);
+
+    report("NUS TEST TOTAL", k_uptime_get() - start_ms, atomic_get(&stat_tx_bytes),
+           atomic_get(&stat_rx_bytes), atomic_get(&stat_sent),
+           stat_notify_calls, stat_notify_cycles, cpu_load_pct(&start_cpu, &cpu));
+    test_conn = NULL;
+}
+
+uint32_t nus_test_generate(struct ring_buf *rb)
+{
+    uint8_t *data;
+    uint32_t total = 0;
+    uint32_t len;
+
+    if (!IS_ENABLED(CONFIG_APP_NUS_TEST_GENERATOR) || !running) {
+        return 0;
+    }
+
+    /* 直接在 RingBuffer 内部写数据，可能跨越回绕点，所以最多分两段 */
+    do {
+        len = ring_buf_put_claim(rb, &data, ring_buf_space_get(rb));
+        for (uint32_t i = 0; i < len; i++) {
+            data[i] = gen_next++;
+        }
+        ring_buf_put_finish(rb, len);
+        total += len;
+    } while (len);
+
+    return total;
+}
+
+void nus_test_sink(const uint8_t *data, uint16_t len)
+{
+    uint32_t errors = 0;
+
+    if (!running || len == 0) {
+        return;
+    }
+
+    /* 第一个字节用来同步起点 */
+    if (!sink_synced) {
+        sink_next = data[0];
+        sink_synced = true;
+    }
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] != sink_next) {
+            errors++;
+        }
+        sink_next = data[i] + 1;
+    }
+
+    atomic_add(&stat_rx_bytes, len);
+    if (errors) {
+        atomic_add(&stat_seq_err, errors);
+    }
+}
+
+void nus_test_record_tx(uint32_t len)
+{
+    atomic_add(&stat_tx_bytes, len);
+}
+
+void nus_test_record_retry(void)
+{
+    atomic_inc(&stat_retries);
+}
+
+void nus_test_record_sent(void)
+{
+    atomic_inc(&stat_sent);
+}
+
+void nus_test_record_notify_cycles(uint32_t cycles)
+{
+    k_spinlock_key_t key = k_spin_lock(&notify_lock);
+
+    stat_notify_calls++;
+    stat_notify_cycles += cycles;
+    k_spin_unlock(&notify_lock, key);
+}
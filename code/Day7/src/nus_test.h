@@ -0,0 +1,65 @@
+/*
+ * Module: NUS Throughput Test
+ * Description: 吞吐量测试模式 (发生器 / 接收校验)，由 CONFIG_APP_NUS_TEST 开启
+ *
+ * 测试数据是一个逐字节递增的计数流 (0x00, 0x01, ... 0xFF, 0x00 ...)，
+ * 与分包方式无关，接收端只要检查每个字节是否等于上一个字节 + 1 即可发现丢包/乱序。
+ */
+
+#ifndef NUS_TEST_H_
+#define NUS_TEST_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#if defined(CONFIG_APP_NUS_TEST)
+
+/**
+ * @brief 手机/测试主机订阅通知后开始计时 (发生器模式下同时开始产生数据)
+ * @param conn 当前连接
+ */
+void nus_test_start(struct bt_conn *conn);
+
+/**
+ * @brief 连接断开，打印最终报告并停止统计
+ */
+void nus_test_stop(void);
+
+/**
+ * @brief 发生器：把 RingBuffer 剩余空间全部填满测试数据 (替代 UART 生产者)
+ * @return 本次写入的字节数
+ */
+uint32_t nus_test_generate(struct ring_buf *rb);
+
+/**
+ * @brief 接收端：校验收到的数据是否连续
+ */
+void nus_test_sink(const uint8_t *data, uint16_t len);
+
+/** @brief 记录一次成功提交给协议栈的通知 */
+void nus_test_record_tx(uint32_t len);
+
+/** @brief 记录一次因窗口/缓冲区满而放弃的发送 (重试) */
+void nus_test_record_retry(void);
+
+/** @brief 记录一次通知发送完成 */
+void nus_test_record_sent(void);
+
+/** @brief 记录一次 my_nus_send (成功提交) 花费的 CPU 周期 */
+void nus_test_record_notify_cycles(uint32_t cycles);
+
+#else
+
+static inline void nus_test_start(struct bt_conn *conn) {}
+static inline void nus_test_stop(void) {}
+static inline uint32_t nus_test_generate(struct ring_buf *rb) { return 0; }
+static inline void nus_test_sink(const uint8_t *data, uint16_t len) {}
+static inline void nus_test_record_tx(uint32_t len) {}
+static inline void nus_test_record_retry(void) {}
+static inline void nus_test_record_sent(void) {}
+static inline void nus_test_record_notify_cycles(uint32_t cycles) {}
+
+#endif /* CONFIG_APP_NUS_TEST */
+
+#endif /* NUS_TEST_H_ */
@@ -0,0 +1,45 @@
+/*
+ * Module: PHY Manager
+ * Description: 按链路质量自动选择 PHY (2M → 1M → Coded S2 → Coded S8)
+ *
+ * 每 PHY_MGR_SAMPLE_MS 采样一次链路质量：
+ *   rssi     HCI Read RSSI (所有控制器都支持)，指数平滑
+ *   err      误包率：CRC 错误 + 没收到对端包的连接事件 + 对端没确认的发送包，
+ *            占该区间收发包数的百分比。来自 SoftDevice Controller 的 QoS 连接事件报告
+ *            (CONFIG_BT_LL_SOFTDEVICE)，其他控制器上只按 RSSI 判断。
+ *
+ * 降级快、升级慢：
+ *   连续 PHY_MGR_DOWN_SAMPLES 次 rssi 低于本级门限或 err ≥ PHY_MGR_ERR_DOWN_PCT → 降一级
+ *   连续 PHY_MGR_UP_SAMPLES 次 rssi 高于上一级的进入门限且 err ≤ PHY_MGR_ERR_UP_PCT → 升一级
+ * 进入门限比离开门限高 6 dB (迟滞)。对端或本端不支持 Coded PHY 时停在 1M。
+ *
+ * 每次切换打印一行 "[PHY n] 2M -> 1M (rssi .., err ..%)"，断开时打印每级的停留时间。
+ */
+
+#ifndef PHY_MGR_H_
+#define PHY_MGR_H_
+
+#include <zephyr/types.h>
+#include <zephyr/bluetooth/conn.h>
+
+#if defined(CONFIG_APP_BRIDGE_PHY_AUTO)
+
+/** @brief 初始化模块 (在 bt_enable 之后调用) */
+void phy_mgr_init(void);
+
+/**
+ * @brief 开始管理该连接的 PHY
+ *
+ * 可以在蓝牙回调中调用，采样和 PHY 更新请求都在 System WorkQueue 中进行。
+ * 连接时还停在 1M 的话，第一次采样质量够好就直接升到 2M。
+ */
+void phy_mgr_start(struct bt_conn *conn);
+
+#else
+
+static inline void phy_mgr_init(void) {}
+static inline void phy_mgr_start(struct bt_conn *conn) {}
+
+#endif /* CONFIG_APP_BRIDGE_PHY_AUTO */
+
+#endif /* PHY_MGR_H_ */
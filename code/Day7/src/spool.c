@@ -0,0 +1,179 @@
+/*
+ * Module: Bridge Spool
+ * Description: storage_partition 上的环形日志
+ *
+ * Flash 中的有效数据为 [tail, head) (环形，used 字节)；RAM 中的 stage 是接在 head 后面、
+ * 还没攒满一块的数据。head 总是块对齐，进入一个新扇区时先擦除该扇区。
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/logging/log.h>
+
+#include "spool.h"
+
+LOG_MODULE_REGISTER(spool, LOG_LEVEL_INF);
+
+/* ----------------配置部分---------------- */
+#define SPOOL_PARTITION   storage_partition
+#define SPOOL_BLOCK_SIZE  256    // 写入粒度，必须整除扇区大小
+
+static const struct device *flash_dev;
+static off_t part_off;
+static uint32_t part_size;      /* 取扇区大小的整数倍 */
+static uint32_t sector_size;
+
+static uint32_t head;           /* 下一块写入的位置 (相对分区起点) */
+static uint32_t tail;           /* 下一个读出的位置 */
+static uint32_t used;           /* Flash 中的有效字节数 */
+
+static uint8_t stage[SPOOL_BLOCK_SIZE];
+static uint32_t stage_len;
+
+/* 统计 */
+static uint32_t stat_spooled;
+static uint32_t stat_dropped;
+static uint32_t stat_erases;
+
+int spool_init(void)
+{
+    struct flash_pages_info info;
+    int err;
+
+    flash_dev = FIXED_PARTITION_DEVICE(SPOOL_PARTITION);
+    if (!device_is_ready(flash_dev)) {
+        LOG_ERR("Flash device not ready");
+        flash_dev = NULL;
+        return -ENODEV;
+    }
+
+    part_off = FIXED_PARTITION_OFFSET(SPOOL_PARTITION);
+    err = flash_get_page_info_by_offs(flash_dev, part_off, &info);
+    if (err || info.size % SPOOL_BLOCK_SIZE) {
+        LOG_ERR("Unsupported flash page layout (err %d, page %u)", err, (uint32_t)info.size);
+        flash_dev = NULL;
+        return err ? err : -EINVAL;
+    }
+
+    sector_size = info.size;
+    part_size = ROUND_DOWN(FIXED_PARTITION_SIZE(SPOOL_PARTITION), sector_size);
+    if (part_size < 2 * sector_size) {
+        LOG_ERR("Spool partition too small");
+        flash_dev = NULL;
+        return -ENOSPC;
+    }
+
+    LOG_INF("Spool: %u bytes (%u sectors)", part_size, part_size / sector_size);
+    return 0;
+}
+
+/* 把攒满的一块写进 Flash，返回为腾出空间丢弃的字节数 */
+static uint32_t spool_flush_block(void)
+{
+    uint32_t dropped = 0;
+    int err;
+
+    if (head % sector_size == 0) {
+        /* 要擦除的扇区里还有没读的老数据 (日志已满)：丢弃到该扇区末尾 */
+        while (used + sector_size > part_size) {
+            uint32_t n = MIN(sector_size - tail % sector_size, used);
+
+            tail = (tail + n) % part_size;
+            used -= n;
+            dropped += n;
+        }
+
+        err = flash_erase(flash_dev, part_off + head, sector_size);
+        if (err) {
+            LOG_ERR("Spool erase failed (err %d)", err);
+            dropped += stage_len;
+            stage_len = 0;
+            return dropped;
+        }
+        stat_erases++;
+    }
+
+    err = flash_write(flash_dev, part_off + head, stage, SPOOL_BLOCK_SIZE);
+    if (err) {
+        LOG_ERR("Spool write failed (err %d)", err);
+        dropped += stage_len;
+    } else {
+        head = (head + SPOOL_BLOCK_SIZE) % part_size;
+        used += SPOOL_BLOCK_SIZE;
+    }
+    stage_len = 0;
+
+    return dropped;
+}
+
+uint32_t spool_append(const uint8_t *data, uint32_t len)
+{
+    uint32_t dropped = 0;
+
+    if (!flash_dev) {
+        stat_dropped += len;
+        return len;
+    }
+
+    stat_spooled += len;
+    while (len) {
+        uint32_t n = MIN(len, SPOOL_BLOCK_SIZE - stage_len);
+
+        memcpy(stage + stage_len, data, n);
+        stage_len += n;
+        data += n;
+        len -= n;
+
+        if (stage_len == SPOOL_BLOCK_SIZE) {
+            dropped += spool_flush_block();
+        }
+    }
+
+    stat_dropped += dropped;
+    return dropped;
+}
+
+uint32_t spool_read(uint8_t *buf, uint32_t len)
+{
+    uint32_t n;
+
+    /* 先读 Flash 中的老数据 (一次最多读到分区末尾) */
+    if (used) {
+        n = MIN(MIN(len, used), part_size - tail);
+        if (flash_read(flash_dev, part_off + tail, buf, n)) {
+            LOG_ERR("Spool read failed");
+            return 0;
+        }
+        tail = (tail + n) % part_size;
+        used -= n;
+        return n;
+    }
+
+    /* Flash 已读完，再读 RAM 中还没攒满的尾巴，剩下的部分挪到开头继续攒 */
+    n = MIN(len, stage_len);
+    memcpy(buf, stage, n);
+    memmove(stage, stage + n, stage_len - n);
+    stage_len -= n;
+    return n;
+}
+
+uint32_t spool_size_get(void)
+{
+    return used + stage_len;
+}
+
+uint32_t spool_capacity(void)
+{
+    return part_size;
+}
+
+void spool_stats_report(void)
+{
+    if (!flash_dev) {
+        return;
+    }
+    printk("Spool: %u bytes spooled, %u dropped, %u erases, fill %u / %u\n",
+           stat_spooled, stat_dropped, stat_erases, spool_size_get(), part_size);
+}
@@ -0,0 +1,65 @@
+/*
+ * Module: Bridge Spool
+ * Description: 断线期间的 UART 数据 Flash 缓存 (存储转发)
+ *
+ * 没有连接在接收时，UART 数据不再丢弃，而是追加到 storage_partition 中的环形日志；
+ * 重新连接后按原顺序回放。数据只在 RAM 中攒满一个 SPOOL_BLOCK_SIZE 块才写入 Flash，
+ * 每个字节最多写一次，每写满一个扇区擦除一次 (写放大 = 1)；还没攒满的尾巴直接从 RAM 回放，
+ * 链路比 UART 快时回放期间到来的新数据根本不会落到 Flash。
+ * 日志写满时丢弃最老的一个扇区。
+ *
+ * 注意：读写位置只保存在 RAM 中，复位后缓存内容作废。
+ */
+
+#ifndef SPOOL_H_
+#define SPOOL_H_
+
+#include <zephyr/types.h>
+
+#if defined(CONFIG_APP_BRIDGE_SPOOL)
+
+/**
+ * @brief 初始化 (打开 storage_partition)
+ * @return 0 成功；失败时后续追加的数据按旧行为直接丢弃
+ */
+int spool_init(void);
+
+/**
+ * @brief 追加数据 (可能阻塞在 Flash 擦写上，只能在发送任务中调用)
+ * @return 为腾出空间而丢弃的最老数据字节数
+ */
+uint32_t spool_append(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 按顺序读出最多 len 字节 (读出即移除)
+ * @return 实际读出的字节数，0 表示缓存已空
+ */
+uint32_t spool_read(uint8_t *buf, uint32_t len);
+
+/** @brief 缓存中的字节数 (Flash + RAM) */
+uint32_t spool_size_get(void);
+
+/** @brief 缓存容量 (字节) */
+uint32_t spool_capacity(void);
+
+/** @brief 打印累计统计 (写入量、丢弃量、擦除次数、当前填充) */
+void spool_stats_report(void);
+
+static inline bool spool_is_empty(void)
+{
+    return spool_size_get() == 0;
+}
+
+#else
+
+static inline int spool_init(void) { return 0; }
+static inline uint32_t spool_append(const uint8_t *data, uint32_t len) { return len; }
+static inline uint32_t spool_read(uint8_t *buf, uint32_t len) { return 0; }
+static inline uint32_t spool_size_get(void) { return 0; }
+static inline uint32_t spool_capacity(void) { return 0; }
+static inline void spool_stats_report(void) {}
+static inline bool spool_is_empty(void) { return true; }
+
+#endif /* CONFIG_APP_BRIDGE_SPOOL */
+
+#endif /* SPOOL_H_ */